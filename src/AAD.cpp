@@ -0,0 +1,57 @@
+#include "AAD.h"
+#include "Macros.h"
+
+namespace minirisk {
+
+ADouble Tape::input(const string& name, double value)
+{
+    for (const auto& i : m_inputs)
+        if (i.first == name)
+            return ADouble(value, i.second, this);
+    size_t node = record(npos, 0.0);
+    m_inputs.emplace_back(name, node);
+    return ADouble(value, node, this);
+}
+
+size_t Tape::record(size_t a, double da, size_t b, double db)
+{
+    m_nodes.push_back(node_t{ { a, b }, { da, db } });
+    return m_nodes.size() - 1;
+}
+
+void Tape::backward(const ADouble& result)
+{
+    m_adjoints.assign(m_nodes.size(), 0.0);
+    if (!result.is_active())
+        return; // constant result, all derivatives are zero
+    MYASSERT(result.tape() == this, "Result was not recorded on this tape");
+
+    m_adjoints[result.node()] = 1.0;
+    for (size_t i = result.node() + 1; i-- > 0; ) {
+        const double adj = m_adjoints[i];
+        if (adj == 0.0)
+            continue;
+        const node_t& n = m_nodes[i];
+        for (size_t k = 0; k < 2; ++k)
+            if (n.arg[k] != npos)
+                m_adjoints[n.arg[k]] += adj * n.partial[k];
+    }
+}
+
+std::vector<std::pair<string, double>> Tape::gradient() const
+{
+    std::vector<std::pair<string, double>> res;
+    res.reserve(m_inputs.size());
+    for (const auto& i : m_inputs)
+        res.emplace_back(i.first, i.second < m_adjoints.size() ? m_adjoints[i.second] : 0.0);
+    return res;
+}
+
+void Tape::clear()
+{
+    m_nodes.clear();
+    m_adjoints.clear();
+    m_inputs.clear();
+}
+
+} // namespace minirisk
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+#include "Global.h"
+#include "Macros.h"
+
+namespace minirisk {
+
+struct ADouble;
+
+// Records the operations performed on ADouble numbers, so that the derivatives
+// of a result with respect to all the inputs can be computed with a single
+// backward sweep (reverse mode adjoint algorithmic differentiation).
+// Inputs are identified by the name of the risk factor they represent.
+// A tape is not thread safe: each thread must record on its own tape.
+struct Tape
+{
+    // register a risk factor as an input of the calculation. Registering the
+    // same risk factor twice returns the same variable.
+    ADouble input(const string& name, double value);
+
+    // record a node depending on up to two operands with the given partial derivatives
+    size_t record(size_t a, double da, size_t b = npos, double db = 0.0);
+
+    // propagate the adjoint of the result back to all nodes
+    void backward(const ADouble& result);
+
+    // derivatives of the last result passed to backward, for all inputs in registration order
+    std::vector<std::pair<string, double>> gradient() const;
+
+    // discard all nodes and inputs, keeping the allocated memory
+    void clear();
+
+    size_t size() const { return m_nodes.size(); }
+
+    static const size_t npos = size_t(-1);
+
+private:
+    struct node_t
+    {
+        size_t arg[2];
+        double partial[2];
+    };
+
+    std::vector<node_t> m_nodes;
+    std::vector<double> m_adjoints;
+    std::vector<std::pair<string, size_t>> m_inputs;
+};
+
+// Active scalar: a value together with the tape node recording how it was computed.
+// Numbers which are not on a tape (i.e. constants) have no node.
+struct ADouble
+{
+    ADouble(double v = 0.0)
+        : m_value(v), m_node(Tape::npos), m_tape(nullptr)
+    {
+    }
+
+    ADouble(double v, size_t node, Tape* tape)
+        : m_value(v), m_node(node), m_tape(tape)
+    {
+    }
+
+    double value() const { return m_value; }
+    size_t node() const { return m_node; }
+    Tape* tape() const { return m_tape; }
+    bool is_active() const { return m_tape != nullptr; }
+
+private:
+    double m_value;
+    size_t m_node;
+    Tape* m_tape;
+};
+
+//
+// Operators. Each records one node with the partial derivatives with respect to its operands.
+//
+
+inline ADouble ad_apply(double v, const ADouble& a, double da)
+{
+    if (!a.is_active())
+        return ADouble(v);
+    return ADouble(v, a.tape()->record(a.node(), da), a.tape());
+}
+
+inline ADouble ad_apply(double v, const ADouble& a, double da, const ADouble& b, double db)
+{
+    if (!a.is_active())
+        return ad_apply(v, b, db);
+    if (!b.is_active())
+        return ad_apply(v, a, da);
+    MYASSERT(a.tape() == b.tape(), "Operands recorded on different tapes");
+    return ADouble(v, a.tape()->record(a.node(), da, b.node(), db), a.tape());
+}
+
+inline ADouble operator-(const ADouble& a)
+{
+    return ad_apply(-a.value(), a, -1.0);
+}
+
+inline ADouble operator+(const ADouble& a, const ADouble& b)
+{
+    return ad_apply(a.value() + b.value(), a, 1.0, b, 1.0);
+}
+
+inline ADouble operator-(const ADouble& a, const ADouble& b)
+{
+    return ad_apply(a.value() - b.value(), a, 1.0, b, -1.0);
+}
+
+inline ADouble operator*(const ADouble& a, const ADouble& b)
+{
+    return ad_apply(a.value() * b.value(), a, b.value(), b, a.value());
+}
+
+inline ADouble operator/(const ADouble& a, const ADouble& b)
+{
+    double r = a.value() / b.value();
+    return ad_apply(r, a, 1.0 / b.value(), b, -r / b.value());
+}
+
+inline ADouble exp(const ADouble& a)
+{
+    double r = std::exp(a.value());
+    return ad_apply(r, a, r);
+}
+
+inline ADouble log(const ADouble& a)
+{
+    return ad_apply(std::log(a.value()), a, 1.0 / a.value());
+}
+
+} // namespace minirisk
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <memory_resource>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "Global.h"
+#include "Macros.h"
+
+namespace minirisk {
+
+// Sequence of objects of type T stored in contiguous chunks carved out of a memory
+// resource, typically a monotonic arena shared by the sequences of several types.
+// Objects are never moved, so pointers to them stay valid, and they are destroyed
+// together with the sequence; the memory itself is returned in one shot when the
+// arena is destroyed.
+template <typename T>
+struct ArenaVector
+{
+    static const size_t chunk_size = 1024; // objects per contiguous chunk
+
+    explicit ArenaVector(std::pmr::memory_resource* mem)
+        : m_mem(mem), m_size(0)
+    {
+    }
+
+    ~ArenaVector()
+    {
+        for (size_t i = 0; i < m_size; ++i)
+            (*this)[i].~T();
+    }
+
+    ArenaVector(const ArenaVector&) = delete;
+    ArenaVector& operator=(const ArenaVector&) = delete;
+
+    // construct a new object at the end of the sequence, returns its index
+    template <typename... Args>
+    size_t emplace_back(Args&&... args)
+    {
+        if (m_size == m_chunks.size() * chunk_size)
+            m_chunks.push_back(static_cast<T*>(m_mem->allocate(chunk_size * sizeof(T), alignof(T))));
+        new (m_chunks.back() + m_size % chunk_size) T(std::forward<Args>(args)...);
+        return m_size++;
+    }
+
+    size_t size() const { return m_size; }
+
+    T& operator[](size_t i) { return m_chunks[i / chunk_size][i % chunk_size]; }
+    const T& operator[](size_t i) const { return m_chunks[i / chunk_size][i % chunk_size]; }
+
+    // bytes reserved for the objects
+    size_t capacity_bytes() const { return m_chunks.size() * chunk_size * sizeof(T); }
+
+private:
+    std::pmr::memory_resource* m_mem;
+    std::vector<T*> m_chunks;
+    size_t m_size;
+};
+
+} // namespace minirisk
@@ -0,0 +1,426 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <thread>
+
+#include "CounterRNG.h"
+#include "CurveDiscount.h"
+#include "MarketDataServer.h"
+#include "PortfolioGenerator.h"
+#include "PortfolioUtils.h"
+#include "ThreadPool.h"
+#include "TradeBook.h"
+
+using namespace ::minirisk;
+
+// Benchmark suite.
+// Generates a portfolio and the market data to price it, then times micro benchmarks
+// (single operations on dates, curves, parsing and market lookups) and macro
+// benchmarks (loading and risking the whole portfolio). Results can be saved as a
+// baseline and later runs compared against it, flagging any benchmark whose throughput
+// dropped by more than the tolerance. A baseline records the settings of the generated
+// workload, and is only compared with runs having the same settings.
+
+// command line settings
+struct options_t
+{
+    generator_settings_t gen;
+    size_t n_threads = 1;
+    size_t samples = 11;      // timed repetitions of each benchmark
+    string baseline_file;     // compare against this baseline
+    string write_file;        // save the results as a baseline
+    double tolerance = 0.10;  // relative throughput loss flagged as a regression
+    string filter;            // run only the benchmarks whose name contains this string
+};
+
+// result of one benchmark
+struct bench_t
+{
+    string name;
+    double throughput; // operations per second
+    double p50;        // latency percentiles, in nanoseconds per operation
+    double p90;
+    double p99;
+    size_t states;     // bumped market states per operation of the risk benchmarks, 0 otherwise
+};
+
+// keeps the compiler from optimizing away the benchmarked code
+volatile double sink = 0.0;
+
+// Time samples runs of f, which performs ops operations and returns a checksum.
+// The latency of a sample is its time divided by ops, so that the percentiles of
+// cheap operations are not dominated by the resolution of the clock.
+template <typename F>
+bench_t measure(const string& name, size_t ops, size_t samples, F f)
+{
+    typedef std::chrono::steady_clock clock_t;
+    sink = sink + f(); // warm up
+    std::vector<double> latency(samples);
+    double total = 0.0;
+    for (size_t s = 0; s < samples; ++s) {
+        auto t0 = clock_t::now();
+        sink = sink + f();
+        double ns = std::chrono::duration<double, std::nano>(clock_t::now() - t0).count();
+        latency[s] = ns / ops;
+        total += ns;
+    }
+    std::sort(latency.begin(), latency.end());
+    auto pct = [&](double q) { return latency[std::min(samples - 1, size_t(std::ceil(q * samples)) - 1)]; };
+    return bench_t{ name, ops * samples / (total * 1e-9), pct(0.5), pct(0.9), pct(0.99), 0 };
+}
+
+// the settings determining what the benchmarks measure. Runs are comparable only
+// if they have the same workload.
+string workload(const options_t& opt)
+{
+    std::ostringstream os;
+    os << "trades=" << opt.gen.n_trades << ",seed=" << opt.gen.seed
+       << ",threads=" << (opt.n_threads ? opt.n_threads : std::max(1u, std::thread::hardware_concurrency()))
+       << ",mix=";
+    for (const auto& c : opt.gen.ccy_mix)
+        os << c.first << ":" << c.second << (&c == &opt.gen.ccy_mix.back() ? "" : "/");
+    os << ",fx_share=" << std::setprecision(15) << opt.gen.fx_forward_share
+       << ",pillars=" << opt.gen.pillars << ",days=" << opt.gen.max_days;
+    return os.str();
+}
+
+// baseline file: a first line workload;<workload>; followed by one line per
+// benchmark, name;throughput;p50;p90;p99;states;
+void save_baseline(const string& filename, const string& work, const std::vector<bench_t>& results)
+{
+    my_ofstream os(filename);
+    os << string("workload") << work;
+    os.endl();
+    for (const auto& r : results) {
+        os << r.name << r.throughput << r.p50 << r.p90 << r.p99 << r.states;
+        os.endl();
+    }
+    os.close();
+}
+
+std::map<string, bench_t> load_baseline(const string& filename, string& work)
+{
+    std::map<string, bench_t> res;
+    my_ifstream is(filename);
+    string tag;
+    MYASSERT(is.read_line() && (is >> tag, tag == "workload"), "Baseline " << filename << " does not record its workload");
+    is >> work;
+    while (is.read_line()) {
+        bench_t r;
+        is >> r.name >> r.throughput >> r.p50 >> r.p90 >> r.p99 >> r.states;
+        res[r.name] = r;
+    }
+    return res;
+}
+
+std::vector<bench_t> run_benchmarks(const options_t& opt)
+{
+    const Date today(2017, 8, 5);
+    const size_t samples = opt.samples;
+    std::vector<bench_t> results;
+    auto bench = [&](const string& name, size_t ops, auto f, size_t states = 0)
+    {
+        if (name.find(opt.filter) == string::npos)
+            return;
+        results.push_back(measure(name, ops, samples, f));
+        bench_t& r = results.back();
+        r.states = states;
+        std::cout << std::left << std::setw(28) << r.name << std::right
+                  << std::setw(14) << std::setprecision(4) << r.throughput << " ops/s"
+                  << std::setw(10) << r.p50 << std::setw(10) << r.p90 << std::setw(10) << r.p99 << " ns";
+        if (states)
+            std::cout << "   " << states << " bumped states";
+        std::cout << "\n";
+    };
+
+    // input files
+    const string portfolio_file = "bench_portfolio.txt";
+    const string flat_file = "bench_risk_factors_flat.txt";
+    const string pillar_file = "bench_risk_factors_pillars.txt";
+    generator_settings_t flat(opt.gen), pillars(opt.gen);
+    flat.pillars = false;
+    pillars.pillars = true;
+    generate_risk_factors(flat_file, flat);
+    generate_risk_factors(pillar_file, pillars);
+    portfolio_t portfolio = generate_portfolio(opt.gen, today);
+    save_portfolio(portfolio_file, portfolio);
+    const string& rf_file = opt.gen.pillars ? pillar_file : flat_file;
+
+    std::cout << "Portfolio: " << portfolio.size() << " trades, seed " << opt.gen.seed << "\n\n"
+              << std::left << std::setw(28) << "benchmark" << std::right
+              << std::setw(20) << "throughput" << std::setw(10) << "p50" << std::setw(10) << "p90" << std::setw(10) << "p99\n";
+
+    //
+    // micro benchmarks
+    //
+
+    const size_t n = 1 << 16;
+    const CounterRNG rng(opt.gen.seed);
+    std::vector<Date> dates(n);
+    std::vector<unsigned> ymd(3 * n);
+    for (size_t i = 0; i < n; ++i) {
+        dates[i] = Date(today.serial() + unsigned(rng.uniform({ { uint32_t(i), 0, 0, 0 } }) * std::min(opt.gen.max_days, 3650u)));
+        ymd[3 * i] = dates[i].year();
+        ymd[3 * i + 1] = dates[i].month();
+        ymd[3 * i + 2] = dates[i].day();
+    }
+    std::vector<double> out(n);
+
+    bench("date.ymd", n, [&] {
+        unsigned s = 0;
+        for (size_t i = 0; i < n; ++i)
+            s += Date(ymd[3 * i], ymd[3 * i + 1], ymd[3 * i + 2]).serial();
+        return double(s);
+    });
+    bench("date.time_frac", n, [&] {
+        double s = 0.0;
+        for (size_t i = 0; i < n; ++i)
+            s += time_frac(today, dates[i]);
+        return s;
+    });
+    bench("date.time_frac_bulk", n, [&] {
+        time_frac(today, dates, out);
+        return out[n / 2];
+    });
+
+    for (const string& file : { flat_file, pillar_file }) {
+        std::shared_ptr<const MarketDataServer> mds(new MarketDataServer(file));
+        Market mkt(mds, today);
+        const string kind = file == flat_file ? "flat" : "pillars";
+        const string ccy = opt.gen.ccy_mix[0].first;
+        CurveDiscount curve(&mkt, today, ir_curve_discount_name(ccy));
+        bench("curve.df_" + kind, n, [&] {
+            double s = 0.0;
+            for (size_t i = 0; i < n; ++i)
+                s += curve.df(dates[i]);
+            return s;
+        });
+        bench("curve.df_batch_" + kind, n, [&] {
+            curve.df(dates, out);
+            return out[n / 2];
+        });
+    }
+
+    {
+        std::ostringstream os;
+        std::ifstream is(portfolio_file);
+        os << is.rdbuf();
+        const string text = os.str();
+        bench("streamer.parse", portfolio.size(), [&] {
+            TradeBook book;
+            my_ifstream is(text.data(), text.data() + text.size());
+            while (is.read_line())
+                book.load_trade(is);
+            return double(book.size());
+        });
+    }
+
+    {
+        std::shared_ptr<const MarketDataServer> mds(new MarketDataServer(rf_file));
+        Market mkt(mds, today);
+        std::vector<string> curves, spots;
+        for (const auto& c : opt.gen.ccy_mix) {
+            curves.push_back(ir_curve_discount_name(c.first));
+            if (c.first != "USD")
+                spots.push_back(fx_spot_name(c.first, "USD"));
+        }
+        std::vector<size_t> handles;
+        for (const auto& c : curves)
+            handles.push_back(mkt.bind_discount_curve(c));
+        bench("market.get_discount_curve", n, [&] {
+            double s = 0.0;
+            for (size_t i = 0; i < n; ++i)
+                s += mkt.get_discount_curve(curves[i % curves.size()])->today().serial();
+            return s;
+        });
+        bench("market.discount_curve_handle", n, [&] {
+            double s = 0.0;
+            for (size_t i = 0; i < n; ++i)
+                s += mkt.discount_curve(handles[i % handles.size()])->today().serial();
+            return s;
+        });
+        if (!spots.empty())
+            bench("market.get_fx_spot", n, [&] {
+                double s = 0.0;
+                for (size_t i = 0; i < n; ++i)
+                    s += mkt.get_fx_spot(spots[i % spots.size()]);
+                return s;
+            });
+    }
+
+    //
+    // macro benchmarks
+    //
+
+    ThreadPool pool(opt.n_threads);
+    std::shared_ptr<const MarketDataServer> mds(new MarketDataServer(rf_file));
+    const size_t n_trades = portfolio.size();
+
+    bench("macro.load_portfolio", n_trades, [&] {
+        return double(load_portfolio(portfolio_file, &pool).size());
+    });
+
+    std::vector<ppricer_t> pricers(get_pricers(portfolio));
+    bench("macro.get_pricers", n_trades, [&] {
+        return double(get_pricers(portfolio).size());
+    });
+
+    Market mkt(mds, today);
+    bind_pricers(pricers, mkt);
+    portfolio_dependencies_t deps;
+    portfolio_values_t prices = compute_prices(pricers, mkt, &pool, &deps);
+    mkt.disconnect();
+    mkt.freeze();
+
+    bench("macro.compute_prices", n_trades, [&] {
+        Market tmpmkt(mkt);
+        return portfolio_total(compute_prices(pricers, tmpmkt, &pool));
+    });
+    // a down and an up state per rate: a sweep without states would only time the bookkeeping
+    const size_t pv01_states = 2 * compute_pv01(pricers, mkt, &pool, &deps).size();
+    MYASSERT(pv01_states > 0, "The PV01 benchmark has no risk factor to bump");
+    bench("macro.compute_pv01", n_trades, [&] {
+        double s = 0.0;
+        for (const auto& g : compute_pv01(pricers, mkt, &pool, &deps))
+            s += portfolio_total(g.second);
+        return s;
+    }, pv01_states);
+    bench("macro.end_to_end", n_trades, [&] {
+        // load, price and compute PV01 from scratch
+        std::vector<ppricer_t> p(get_pricers(load_portfolio(portfolio_file, &pool)));
+        Market m(mds, today);
+        bind_pricers(p, m);
+        portfolio_dependencies_t d;
+        double s = portfolio_total(compute_prices(p, m, &pool, &d));
+        for (const auto& g : compute_pv01(p, m, &pool, &d))
+            s += portfolio_total(g.second);
+        return s;
+    });
+
+    return results;
+}
+
+void usage()
+{
+    std::cerr
+        << "Invalid command line arguments\n"
+        << "Example:\n"
+        << "Benchmark [-n trades] [-r seed] [-m USD:4,EUR:3] [-d days] [-x share] [-k 0|1] [-t threads] [-s samples] [-b baseline.txt] [-w baseline.txt] [-l tolerance] [-f filter]\n"
+        << "  -n  number of trades of the generated portfolio (default 100000)\n"
+        << "  -r  seed of the generator (default 1)\n"
+        << "  -m  currencies and their relative weights (default USD:4,EUR:3,GBP:2,JPY:1)\n"
+        << "  -d  trade dates are spread over this many days from today (default 3650)\n"
+        << "  -x  fraction of FX forwards (default 0.2)\n"
+        << "  -k  1 to price the macro benchmarks on tenor pillar curves (default 0)\n"
+        << "  -t  number of threads of the macro benchmarks, 0 for one per core (default 1)\n"
+        << "  -s  timed samples per benchmark (default 11)\n"
+        << "  -b  compare with this baseline and flag regressions\n"
+        << "  -w  save the results as a baseline to this file\n"
+        << "  -l  relative loss of throughput flagged as a regression (default 0.10)\n"
+        << "  -f  run only the benchmarks whose name contains this string\n";
+    std::exit(-1);
+}
+
+int main(int argc, const char **argv)
+{
+    // parse command line arguments
+    options_t opt;
+    opt.gen.n_trades = 100000;
+    opt.gen.fx_forward_share = 0.2;
+    if (argc % 2 == 0)
+        usage();
+    for (int i = 1; i < argc; i += 2)
+    {
+        string key(argv[i]);
+        string value(argv[i + 1]);
+        if (key == "-n")
+            opt.gen.n_trades = std::stoul(value);
+        else if (key == "-r")
+            opt.gen.seed = std::stoull(value);
+        else if (key == "-m")
+            opt.gen.ccy_mix = parse_ccy_mix(value);
+        else if (key == "-d")
+            opt.gen.max_days = std::stoul(value);
+        else if (key == "-x")
+            opt.gen.fx_forward_share = std::stod(value);
+        else if (key == "-k" && (value == "0" || value == "1"))
+            opt.gen.pillars = value == "1";
+        else if (key == "-t")
+            opt.n_threads = std::stoul(value);
+        else if (key == "-s")
+            opt.samples = std::stoul(value);
+        else if (key == "-b")
+            opt.baseline_file = value;
+        else if (key == "-w")
+            opt.write_file = value;
+        else if (key == "-l")
+            opt.tolerance = std::stod(value);
+        else if (key == "-f")
+            opt.filter = value;
+        else
+            usage();
+    }
+    if (opt.samples == 0 || opt.gen.n_trades == 0)
+        usage();
+
+    try
+    {
+        // check the baseline before spending time on the benchmarks
+        std::map<string, bench_t> baseline;
+        if (!opt.baseline_file.empty())
+        {
+            string baseline_workload;
+            baseline = load_baseline(opt.baseline_file, baseline_workload);
+            MYASSERT(baseline_workload == workload(opt), "Baseline " << opt.baseline_file << " is not comparable: its workload is "
+                << baseline_workload << ", this run's is " << workload(opt));
+        }
+
+        std::vector<bench_t> results(run_benchmarks(opt));
+
+        if (!opt.write_file.empty())
+        {
+            save_baseline(opt.write_file, workload(opt), results);
+            std::cout << "\nBaseline saved to " << opt.write_file << "\n";
+        }
+
+        if (opt.baseline_file.empty())
+            return 0;
+
+        // compare the throughput with the baseline
+        size_t regressions = 0;
+        std::cout << "\nComparison with " << opt.baseline_file << ":\n";
+        for (const auto& r : results)
+        {
+            auto b = baseline.find(r.name);
+            if (b == baseline.end())
+            {
+                std::cout << std::left << std::setw(28) << r.name << std::right << "   not in baseline\n";
+                continue;
+            }
+            if (r.states != b->second.states)
+            {
+                // the runs bumped different markets, their throughputs are not comparable
+                std::cout << std::left << std::setw(28) << r.name << std::right << "   " << r.states
+                          << " bumped states, " << b->second.states << " in baseline\n";
+                continue;
+            }
+            const double change = r.throughput / b->second.throughput - 1.0;
+            const bool regression = change < -opt.tolerance;
+            regressions += regression;
+            std::cout << std::left << std::setw(28) << r.name << std::right
+                      << std::setw(9) << std::fixed << std::setprecision(1) << 100 * change << "%"
+                      << std::defaultfloat << (regression ? "   REGRESSION" : "") << "\n";
+        }
+        std::cout << "\n" << regressions << " regression(s)\n";
+        return regressions ? 1 : 0;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << "\n";
+        return -1; // report an error to the caller
+    }
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Global.h"
+#include "Macros.h"
+
+namespace minirisk {
+
+// Map from name to objects of type T, where lookups never take a lock and can
+// run concurrently with insertions.
+// The lookup table is immutable once published: an insertion copies it,
+// adds the new entry and atomically publishes the copy (copy on write).
+// Superseded tables are kept until reclaim is called, so that readers still
+// holding them are never left with dangling pointers. Inserting n names retires
+// n tables of up to n entries, i.e. O(n^2) memory, hence the owner must call
+// reclaim at points where no other thread is using the index (the market does it
+// when it is frozen, cleared or bumped), which brings the memory back to O(n).
+// Entries are never removed and their address never changes. Each entry has a
+// dense id, assigned in insertion order, which is preserved by copies.
+template <typename T>
+struct ConcurrentIndex
+{
+    static const size_t npos = size_t(-1);
+
+    ConcurrentIndex()
+        : m_table(publish(new table_t))
+    {
+    }
+
+    // deep copy of all entries visible at the time of the call
+    ConcurrentIndex(const ConcurrentIndex& other)
+    {
+        const table_t* src = other.m_table.load(std::memory_order_acquire);
+        table_t* t = new table_t;
+        t->by_name = src->by_name;
+        for (const auto& e : src->by_id) {
+            m_names.push_back(*e.first);
+            m_entries.emplace_back(*e.second);
+            t->by_id.emplace_back(&m_names.back(), &m_entries.back());
+        }
+        m_table.store(publish(t), std::memory_order_release);
+    }
+
+    ConcurrentIndex& operator=(const ConcurrentIndex&) = delete;
+
+    // number of entries
+    size_t size() const
+    {
+        return m_table.load(std::memory_order_acquire)->by_id.size();
+    }
+
+    // lock free lookup, returns npos if there is no entry with that name
+    size_t find_id(const string& name) const
+    {
+        const table_t* t = m_table.load(std::memory_order_acquire);
+        auto i = t->by_name.find(name);
+        return i == t->by_name.end() ? npos : i->second;
+    }
+
+    // lock free lookup, returns nullptr if there is no entry with that name
+    T* find(const string& name) const
+    {
+        const table_t* t = m_table.load(std::memory_order_acquire);
+        auto i = t->by_name.find(name);
+        return i == t->by_name.end() ? nullptr : t->by_id[i->second].second;
+    }
+
+    // lock free access by id
+    T& at(size_t id) const
+    {
+        const table_t* t = m_table.load(std::memory_order_acquire);
+        MYASSERT(id < t->by_id.size(), "Invalid handle " << id);
+        return *t->by_id[id].second;
+    }
+
+    const string& name(size_t id) const
+    {
+        const table_t* t = m_table.load(std::memory_order_acquire);
+        MYASSERT(id < t->by_id.size(), "Invalid handle " << id);
+        return *t->by_id[id].first;
+    }
+
+    // returns the id of the entry with the given name, inserting T(args...) if not present.
+    // The new entry is fully constructed before it becomes visible to readers.
+    template <typename... Args>
+    size_t find_or_insert_id(const string& name, Args&&... args)
+    {
+        size_t id = find_id(name);
+        if (id != npos)
+            return id;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const table_t* t = m_table.load(std::memory_order_relaxed);
+        auto i = t->by_name.find(name);
+        if (i != t->by_name.end())  // inserted by another thread meanwhile
+            return i->second;
+        m_names.push_back(name);
+        m_entries.emplace_back(std::forward<Args>(args)...);
+        table_t* next = new table_t(*t);
+        id = next->by_id.size();
+        next->by_id.emplace_back(&m_names.back(), &m_entries.back());
+        next->by_name.emplace(name, id);
+        m_table.store(publish(next), std::memory_order_release);
+        return id;
+    }
+
+    template <typename... Args>
+    T& find_or_insert(const string& name, Args&&... args)
+    {
+        return at(find_or_insert_id(name, std::forward<Args>(args)...));
+    }
+
+    // free the superseded tables. Must not run concurrently with any other method.
+    void reclaim()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_tables.size() > 1)
+            m_tables.erase(m_tables.begin(), m_tables.end() - 1); // the last one is current
+    }
+
+    // calls f(name, entry) for all entries, sorted by name
+    template <typename F>
+    void for_each(F f) const
+    {
+        const table_t* t = m_table.load(std::memory_order_acquire);
+        for (const auto& e : t->by_name)
+            f(e.first, *t->by_id[e.second].second);
+    }
+
+private:
+    struct table_t
+    {
+        std::map<string, size_t> by_name;
+        std::vector<std::pair<const string*, T*>> by_id;
+    };
+
+    // take ownership of a table which is about to be published
+    const table_t* publish(table_t* t)
+    {
+        m_tables.emplace_back(t);
+        return t;
+    }
+
+private:
+    std::deque<string> m_names;                           // stable addresses
+    std::deque<T> m_entries;                              // stable addresses
+    std::vector<std::unique_ptr<const table_t>> m_tables; // current and retired tables
+    std::atomic<const table_t*> m_table;                  // current table
+    std::mutex m_mutex;                                   // serializes writers
+};
+
+} // namespace minirisk
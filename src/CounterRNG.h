@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+namespace minirisk {
+
+// Counter based random number generator (Philox4x32-10, Salmon et al. 2011).
+// Each draw is a pure function of a key (the seed) and a counter, so that any
+// random number can be generated independently of all the others: results do not
+// depend on the order of evaluation, hence on how the work is split across threads.
+struct CounterRNG
+{
+    typedef std::array<uint32_t, 4> counter_t;
+
+    explicit CounterRNG(uint64_t seed)
+        : m_key{ { uint32_t(seed), uint32_t(seed >> 32) } }
+    {
+    }
+
+    // 128 random bits for the given counter
+    counter_t operator()(counter_t c) const
+    {
+        std::array<uint32_t, 2> k = m_key;
+        for (int round = 0; round < 10; ++round) {
+            const uint64_t p0 = uint64_t(0xD2511F53) * c[0];
+            const uint64_t p1 = uint64_t(0xCD9E8D57) * c[2];
+            c = counter_t{ { uint32_t(p1 >> 32) ^ c[1] ^ k[0], uint32_t(p1), uint32_t(p0 >> 32) ^ c[3] ^ k[1], uint32_t(p0) } };
+            k[0] += 0x9E3779B9;
+            k[1] += 0xBB67AE85;
+        }
+        return c;
+    }
+
+    // uniform draw in [0,1) with 53 random bits for the given counter
+    double uniform(const counter_t& c) const
+    {
+        counter_t r = (*this)(c);
+        return double((uint64_t(r[0]) << 21 ^ r[1]) & ((uint64_t(1) << 53) - 1)) / 9007199254740992.0;
+    }
+
+    // standard normal draw for the given counter (Box-Muller)
+    double normal(const counter_t& c) const
+    {
+        counter_t r = (*this)(c);
+        // two uniforms in (0,1] with 53 random bits each
+        const double scale = 1.0 / 9007199254740992.0; // 2^-53
+        double u1 = double((uint64_t(r[0]) << 21 ^ r[1]) & ((uint64_t(1) << 53) - 1)) * scale + scale;
+        double u2 = double((uint64_t(r[2]) << 21 ^ r[3]) & ((uint64_t(1) << 53) - 1)) * scale;
+        return std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+    }
+
+private:
+    std::array<uint32_t, 2> m_key;
+};
+
+} // namespace minirisk
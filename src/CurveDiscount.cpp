@@ -1,24 +1,159 @@
 #include "CurveDiscount.h"
 #include "Market.h"
 #include "Streamer.h"
+#include "VecMath.h"
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
 
 
 namespace minirisk {
 
+namespace {
+
+// dates cached by flat curves, which have no last pillar
+const size_t flat_cache_days = 100 * 365;
+
+// length in days of a tenor like 1W, 3M or 10Y
+unsigned tenor_days(const string& tenor)
+{
+    MYASSERT(tenor.size() >= 2, "Invalid tenor " << tenor);
+    unsigned n = parse_integer<unsigned>(std::string_view(tenor).substr(0, tenor.size() - 1));
+    switch (tenor.back()) {
+    case 'D': return n;
+    case 'W': return n * 7;
+    case 'M': return n * 30;
+    case 'Y': return n * 365;
+    }
+    THROW("Invalid tenor " << tenor);
+}
+
+} // anonymous namespace
+
 CurveDiscount::CurveDiscount(Market *mkt, const Date& today, const string& curve_name)
     : m_today(today)
     , m_name(curve_name)
-    , m_rate(mkt->get_yield(curve_name.substr(ir_curve_discount_prefix.length(),3)))
 {
+    const string ccy = curve_name.substr(ir_curve_discount_prefix.length(), 3);
+
+    Market::vec_risk_factor_t pillars = mkt->get_yield_pillars(ccy);
+    if (pillars.empty()) {
+        // flat curve
+        m_max_t = std::numeric_limits<double>::infinity();
+        m_max_days = 0;
+        m_pillar_t.push_back(m_max_t);
+        m_pillar_rate.push_back(mkt->get_yield(ccy));
+        m_pillar_name.push_back(ir_rate_prefix + ccy);
+        m_start.push_back(0.0);
+        m_start_rt.push_back(0.0);
+        m_fwd.push_back(m_pillar_rate[0]);
+        if (mkt->df_cache_stats())
+            m_cache.reset(new DFCache(today, flat_cache_days, mkt->df_cache_stats()));
+        return;
+    }
+
+    // sort the pillars by maturity: the tenor is the middle part of IR.<tenor>.<ccy>
+    std::vector<std::pair<unsigned, size_t>> order;
+    for (size_t i = 0; i < pillars.size(); ++i) {
+        const string& n = pillars[i].first;
+        order.emplace_back(tenor_days(n.substr(ir_rate_prefix.length(), n.length() - ir_rate_prefix.length() - ccy.length() - 1)), i);
+    }
+    std::sort(order.begin(), order.end());
+
+    double t0 = 0.0, rt0 = 0.0;
+    for (const auto& o : order) {
+        const double t = o.first / 365.0;
+        const double r = pillars[o.second].second;
+        MYASSERT(t > t0, "Curve " << m_name << " has two pillars with the same maturity");
+        m_pillar_t.push_back(t);
+        m_pillar_rate.push_back(r);
+        m_pillar_name.push_back(pillars[o.second].first);
+        m_start.push_back(t0);
+        m_start_rt.push_back(rt0);
+        m_fwd.push_back((r * t - rt0) / (t - t0));
+        t0 = t;
+        rt0 = r * t;
+    }
+    m_max_t = t0;
+    m_max_days = order.back().first;
+    if (mkt->df_cache_stats())
+        m_cache.reset(new DFCache(today, order.back().first + 1, mkt->df_cache_stats()));
+}
+
+void CurveDiscount::check_last_tenor(double dt, const Date& t) const
+{
+    MYASSERT(dt <= m_max_t, "Curve " << m_name << ", DF not available beyond last tenor date " << Date(m_today.serial() + m_max_days) << ", requested " << t);
+}
+
+double CurveDiscount::integrated_rate(const Date& t) const
+{
+    MYASSERT((!(t < m_today)), "cannot get discount factor for date in the past: " << t);
+    double dt = time_frac(m_today, t);
+    check_last_tenor(dt, t);
+    size_t k = interval(dt);
+    return m_start_rt[k] + m_fwd[k] * (dt - m_start[k]);
 }
 
 double  CurveDiscount::df(const Date& t) const
+{
+    if (m_cache)
+        return m_cache->get(t, [&] { return std::exp(-integrated_rate(t)); });
+    return std::exp(-integrated_rate(t));
+}
+
+void CurveDiscount::df(std::span<const Date> t, std::span<double> out) const
+{
+    if (!m_cache) {
+        // compute all the year fractions, then the exponents, then evaluate all
+        // the exponentials in one vectorized pass
+        time_frac(m_today, t, out);
+        for (size_t i = 0; i < t.size(); ++i) {
+            const double dt = out[i];
+            MYASSERT(dt >= 0.0, "cannot get discount factor for date in the past: " << t[i]);
+            check_last_tenor(dt, t[i]);
+            size_t k = interval(dt);
+            out[i] = -(m_start_rt[k] + m_fwd[k] * (dt - m_start[k]));
+        }
+        vexp(out.data(), out.data(), out.size());
+        return;
+    }
+
+    // take what is in the cache, then evaluate the missing exponentials in one
+    // vectorized pass and add them to the cache
+    std::vector<size_t> missing;
+    std::vector<double> x;
+    for (size_t i = 0; i < t.size(); ++i) {
+        out[i] = m_cache->find(t[i]);
+        if (std::isnan(out[i])) {
+            missing.push_back(i);
+            x.push_back(-integrated_rate(t[i]));
+        }
+    }
+    vexp(x.data(), x.data(), x.size());
+    for (size_t k = 0; k < missing.size(); ++k) {
+        out[missing[k]] = x[k];
+        m_cache->insert(t[missing[k]], x[k]);
+    }
+}
+
+ADouble CurveDiscount::df(const Date& t, Tape& tape) const
 {
     MYASSERT((!(t < m_today)), "cannot get discount factor for date in the past: " << t);
     double dt = time_frac(m_today, t);
-    return std::exp(-m_rate * dt);
+    check_last_tenor(dt, t);
+    size_t k = interval(dt);
+
+    // flat curve: r*t
+    if (std::isinf(m_pillar_t[k]))
+        return exp(-tape.input(m_pillar_name[k], m_pillar_rate[k]) * dt);
+
+    // linear interpolation of r*T between the pillars delimiting the interval
+    double w = (dt - m_start[k]) / (m_pillar_t[k] - m_start[k]);
+    ADouble rt = tape.input(m_pillar_name[k], m_pillar_rate[k]) * (m_pillar_t[k] * w);
+    if (k > 0)
+        rt = rt + tape.input(m_pillar_name[k - 1], m_pillar_rate[k - 1]) * (m_pillar_t[k - 1] * (1.0 - w));
+    return exp(-rt);
 }
 
 } // namespace minirisk
@@ -1,10 +1,24 @@
 #pragma once
 #include "ICurve.h"
+#include "DFCache.h"
+
+#include <memory>
+#include <vector>
 
 namespace minirisk {
 
 struct Market;
 
+// Discount curve of a currency, built from the yield risk factors of the market.
+// If the market has tenor rates IR.<tenor>.<ccy> (e.g. IR.1W.EUR ... IR.10Y.EUR),
+// these are continuously compounded zero rates at the pillars and the instantaneous
+// forward rate is constant between consecutive pillars (and from today to the first
+// pillar); discount factors beyond the last pillar are not available.
+// Otherwise the curve is flat at the rate IR.<ccy>.
+// The integrated rate r*T is precomputed at the pillars, so df(t) costs an interval
+// lookup and one exp irrespective of the number of pillars.
+// If the market has the discount factor cache enabled, discount factors are also
+// memoized by date (see DFCache).
 struct CurveDiscount : ICurveDiscount
 {
     virtual string name() const { return m_name; }
@@ -13,13 +27,46 @@ struct CurveDiscount : ICurveDiscount
 
     // compute the discount factor
     double df(const Date& t) const;
+    ADouble df(const Date& t, Tape& tape) const;
+    void df(std::span<const Date> t, std::span<double> out) const;
 
     virtual Date today() const { return m_today; }
 
+private:
+    // index of the interval containing time t (in years from today)
+    size_t interval(double t) const
+    {
+        // few pillars: a branch free count is faster than a binary search
+        size_t k = 0;
+        for (size_t j = 1; j < m_start.size(); ++j)
+            k += t > m_start[j];
+        return k;
+    }
+
+    // integrated rate from today to t, i.e. -log(df)
+    double integrated_rate(const Date& t) const;
+
+    // throws if t, which is dt years from today, is beyond the last pillar
+    void check_last_tenor(double dt, const Date& t) const;
+
 private:
     Date   m_today;
     string m_name;
-    double m_rate;
+    double m_max_t;  // last pillar, infinity for a flat curve
+    unsigned m_max_days; // last pillar in days from today, unused for a flat curve
+
+    // interval k starts at time m_start[k] with integrated rate m_start_rt[k]
+    // and has forward rate m_fwd[k]
+    std::vector<double> m_start;
+    std::vector<double> m_start_rt;
+    std::vector<double> m_fwd;
+
+    // pillars (one pillar at infinity for a flat curve), for adjoint differentiation
+    std::vector<double> m_pillar_t;
+    std::vector<double> m_pillar_rate;
+    std::vector<string> m_pillar_name; // name of the risk factor of each pillar rate
+
+    std::unique_ptr<DFCache> m_cache; // null if caching is disabled
 };
 
 } // namespace minirisk
@@ -0,0 +1,71 @@
+#include "DFCache.h"
+
+namespace minirisk {
+
+namespace {
+
+std::atomic<size_t> s_next_stripe(0);
+
+} // anonymous namespace
+
+size_t DFCacheStats::stripe()
+{
+    thread_local size_t s = s_next_stripe++ % n_stripes;
+    return s;
+}
+
+uint64_t DFCacheStats::hits() const
+{
+    uint64_t n = 0;
+    for (const auto& s : m_stripes)
+        n += s.hits.load(std::memory_order_relaxed);
+    return n;
+}
+
+uint64_t DFCacheStats::misses() const
+{
+    uint64_t n = 0;
+    for (const auto& s : m_stripes)
+        n += s.misses.load(std::memory_order_relaxed);
+    return n;
+}
+
+DFCache::DFCache(const Date& today, size_t n_days, const std::shared_ptr<DFCacheStats>& stats)
+    : m_first(today.serial())
+    , m_n_days(n_days)
+    , m_n_pages((n_days + page_size - 1) / page_size)
+    , m_pages(new std::atomic<std::atomic<double>*>[m_n_pages])
+    , m_stats(stats)
+{
+    for (size_t i = 0; i < m_n_pages; ++i)
+        m_pages[i].store(nullptr, std::memory_order_relaxed);
+}
+
+DFCache::~DFCache()
+{
+    for (size_t i = 0; i < m_n_pages; ++i)
+        delete[] m_pages[i].load(std::memory_order_relaxed);
+}
+
+std::atomic<double>* DFCache::entry(const Date& t, bool allocate) const
+{
+    const size_t i = size_t(t.serial()) - m_first; // wraps around for dates before today
+    if (i >= m_n_days)
+        return nullptr;
+    std::atomic<std::atomic<double>*>& slot = m_pages[i >> page_bits];
+    std::atomic<double>* page = slot.load(std::memory_order_acquire);
+    if (!page) {
+        if (!allocate)
+            return nullptr;
+        std::atomic<double>* p = new std::atomic<double>[page_size];
+        for (size_t k = 0; k < page_size; ++k)
+            p[k].store(std::numeric_limits<double>::quiet_NaN(), std::memory_order_relaxed);
+        if (slot.compare_exchange_strong(page, p, std::memory_order_acq_rel))
+            page = p;
+        else
+            delete[] p; // another thread published a page meanwhile
+    }
+    return page + (i & (page_size - 1));
+}
+
+} // namespace minirisk
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+
+#include "Date.h"
+
+namespace minirisk {
+
+// Hit and miss counters of the discount factor caches of a market and its copies.
+// Counters are striped across cache lines by thread, so that threads pricing
+// concurrently rarely update the same line.
+struct DFCacheStats
+{
+    void hit() { m_stripes[stripe()].hits.fetch_add(1, std::memory_order_relaxed); }
+    void miss() { m_stripes[stripe()].misses.fetch_add(1, std::memory_order_relaxed); }
+
+    uint64_t hits() const;
+    uint64_t misses() const;
+
+private:
+    static const size_t n_stripes = 16;
+
+    static size_t stripe();
+
+    struct alignas(64) stripe_t
+    {
+        std::atomic<uint64_t> hits{ 0 };
+        std::atomic<uint64_t> misses{ 0 };
+    };
+
+    stripe_t m_stripes[n_stripes];
+};
+
+// Discount factors memoized by date serial, for the dates from today up to a horizon.
+// Entries are stored in a dense array allocated lazily in pages, so a curve only
+// pays for the date ranges it is queried on. Lookups and insertions are lock free:
+// racing threads may both compute a missing value, but they store the same result.
+// The cache belongs to the curve, hence it is discarded whenever the market
+// rebuilds the curve (e.g. in Market::set_risk_factors).
+struct DFCache
+{
+    DFCache(const Date& today, size_t n_days, const std::shared_ptr<DFCacheStats>& stats);
+    ~DFCache();
+
+    DFCache(const DFCache&) = delete;
+    DFCache& operator=(const DFCache&) = delete;
+
+    // cached value for date t, NaN if not present (or beyond the horizon)
+    double find(const Date& t) const
+    {
+        const std::atomic<double>* e = entry(t, false);
+        double v = e ? e->load(std::memory_order_relaxed) : std::numeric_limits<double>::quiet_NaN();
+        if (std::isnan(v))
+            m_stats->miss();
+        else
+            m_stats->hit();
+        return v;
+    }
+
+    // store the value for date t, ignored beyond the horizon
+    void insert(const Date& t, double v) const
+    {
+        if (std::atomic<double>* e = entry(t, true))
+            e->store(v, std::memory_order_relaxed);
+    }
+
+    // cached value for date t, computed by f() if missing
+    template <typename F>
+    double get(const Date& t, F f) const
+    {
+        double v = find(t);
+        if (std::isnan(v)) {
+            v = f();
+            insert(t, v);
+        }
+        return v;
+    }
+
+private:
+    static const size_t page_bits = 9;
+    static const size_t page_size = size_t(1) << page_bits;
+
+    std::atomic<double>* entry(const Date& t, bool allocate) const;
+
+private:
+    unsigned m_first;   // serial of the first cached date
+    size_t m_n_days;    // number of cached dates
+    size_t m_n_pages;
+    std::unique_ptr<std::atomic<std::atomic<double>*>[]> m_pages;
+    std::shared_ptr<DFCacheStats> m_stats;
+};
+
+} // namespace minirisk
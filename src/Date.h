@@ -3,31 +3,95 @@
 #include "Macros.h"
 #include <string>
 #include <array>
+#include <span>
 
 namespace minirisk {
 
+// Calendar tables, generated at compile time
+namespace calendar {
+
+const unsigned first_year = 1900;
+const unsigned last_year = 2200;
+const unsigned n_years = last_year - first_year;
+
+constexpr bool is_leap_year(unsigned year)
+{
+    // multiple of 4, but not of 100 unless also of 400
+    return year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+}
+
+// num of days in month M in a normal year
+constexpr std::array<unsigned, 12> days_in_month = { {31,28,31,30,31,30,31,31,30,31,30,31} };
+
+// num of days since 1-jan to 1-M in a normal year
+constexpr std::array<unsigned, 12> days_ytd = { {0,31,59,90,120,151,181,212,243,273,304,334} };
+
+// num of days since 1-jan-1900 to 1-jan-yyyy, from 1900 to 2200 included
+constexpr std::array<unsigned, n_years + 1> make_days_epoch()
+{
+    std::array<unsigned, n_years + 1> res{};
+    for (unsigned i = 0, s = 0; i <= n_years; ++i) {
+        res[i] = s;
+        s += is_leap_year(first_year + i) ? 366 : 365;
+    }
+    return res;
+}
+
+constexpr std::array<unsigned, n_years + 1> days_epoch = make_days_epoch();
+
+// month (1 to 12) and day (1 to 31) of each day of the year, in a normal and in a leap year
+struct month_day_t
+{
+    unsigned char month;
+    unsigned char day;
+};
+
+constexpr std::array<std::array<month_day_t, 366>, 2> make_month_day()
+{
+    std::array<std::array<month_day_t, 366>, 2> res{};
+    for (unsigned leap = 0; leap < 2; ++leap)
+        for (unsigned m = 0, doy = 0; m < 12; ++m)
+            for (unsigned d = 0; d < days_in_month[m] + (m == 1 ? leap : 0); ++d, ++doy)
+                res[leap][doy] = month_day_t{ (unsigned char)(m + 1), (unsigned char)(d + 1) };
+    return res;
+}
+
+constexpr std::array<std::array<month_day_t, 366>, 2> month_day = make_month_day();
+
+} // namespace calendar
+
+// A calendar date between 1-Jan-1900 and 31-Dec-2199, stored as the number of days
+// since 1-Jan-1900 (the serial number). Differences and comparisons are integer
+// operations, and conversions from and to year, month and day use constant tables
+// generated at compile time.
 struct Date
 {
 public:
-    static const unsigned first_year = 1900;
-    static const unsigned last_year = 2200;
-    static const unsigned n_years = last_year - first_year;
+    static const unsigned first_year = calendar::first_year;
+    static const unsigned last_year = calendar::last_year;
+    static const unsigned n_years = calendar::n_years;
 
-private:
-    static std::string padding_dates(unsigned);
+    static constexpr bool is_leap_year(unsigned year)
+    {
+        return calendar::is_leap_year(year);
+    }
 
-    // number of days elapsed from beginning of the year
-    unsigned day_of_year() const;
+private:
+    typedef calendar::month_day_t month_day_t;
 
-    friend long operator-(const Date& d1, const Date& d2);
+    static std::string padding_dates(unsigned);
 
-    static const std::array<unsigned, 12> days_in_month;  // num of days in month M in a normal year
-    static const std::array<unsigned, 12> days_ytd;      // num of days since 1-jan to 1-M in a normal year
-    static const std::array<unsigned, n_years> days_epoch;   // num of days since 1-jan-1900 to 1-jan-yyyy (until 2200)
+    // index of the year containing the serial date
+    static unsigned year_index(unsigned serial)
+    {
+        // years have at least 365 days, so this overshoots by at most one year
+        unsigned i = serial / 365;
+        return i - (calendar::days_epoch[i] > serial ? 1 : 0);
+    }
 
 public:
     // Default constructor
-    Date() : m_y(1970), m_m(1), m_d(1), m_is_leap(false) {}
+    Date() : m_serial(calendar::days_epoch[1970 - first_year]) {}
 
     // Constructor where the input value is checked.
     Date(unsigned year, unsigned month, unsigned day)
@@ -35,25 +99,36 @@ public:
         init(year, month, day);
     }
 
+    // Constructor from the number of days since 1-Jan-1900 (see serial)
+    explicit Date(unsigned serial)
+    {
+        init_serial(serial);
+    }
+
+    void init_serial(unsigned serial)
+    {
+        MYASSERT(serial < calendar::days_epoch[n_years],
+            "The serial date must correspond to a year smaller than " << last_year << ", got " << serial);
+        m_serial = serial;
+    }
+
     void init(unsigned year, unsigned month, unsigned day)
     {
         check_valid(year, month, day);
-        m_y = (unsigned short) year;
-        m_m = (unsigned char) month;
-        m_d = (unsigned char) day;
-        m_is_leap = is_leap_year(year);
+        m_serial = calendar::days_epoch[year - first_year] + calendar::days_ytd[month - 1]
+            + ((month > 2 && is_leap_year(year)) ? 1 : 0) + (day - 1);
     }
 
     static void check_valid(unsigned y, unsigned m, unsigned d);
 
     bool operator<(const Date& d) const
     {
-        return (m_y < d.m_y) || (m_y == d.m_y && (m_m < d.m_m || (m_m == d.m_m && m_d < d.m_d)));
+        return m_serial < d.m_serial;
     }
 
     bool operator==(const Date& d) const
     {
-        return (m_y == d.m_y) && (m_m == d.m_m) && (m_d == d.m_d);
+        return m_serial == d.m_serial;
     }
 
     bool operator>(const Date& d) const
@@ -64,31 +139,66 @@ public:
     // number of days since 1-Jan-1900
     unsigned serial() const
     {
-        return days_epoch[m_y - 1900] + day_of_year();
+        return m_serial;
+    }
+
+    unsigned year() const
+    {
+        return first_year + year_index(m_serial);
     }
 
-    static bool is_leap_year(unsigned yr);
+    unsigned month() const
+    {
+        return decompose().month;
+    }
+
+    unsigned day() const
+    {
+        return decompose().day;
+    }
 
     // In YYYYMMDD format
     std::string to_string(bool pretty = true) const
     {
+        unsigned y = year();
+        month_day_t md = decompose();
         return pretty
-            ? std::to_string((int)m_d) + "-" + std::to_string((int)m_m) + "-" + std::to_string(m_y)
-            : std::to_string(m_y) + padding_dates((int)m_m) + padding_dates((int)m_d);
+            ? std::to_string((int)md.day) + "-" + std::to_string((int)md.month) + "-" + std::to_string(y)
+            : std::to_string(y) + padding_dates(md.month) + padding_dates(md.day);
+    }
+
+private:
+    month_day_t decompose() const
+    {
+        unsigned i = year_index(m_serial);
+        return calendar::month_day[is_leap_year(first_year + i)][m_serial - calendar::days_epoch[i]];
     }
 
 private:
-    unsigned short m_y;
-    unsigned char m_m;
-    unsigned char m_d;
-    bool m_is_leap;
+    unsigned m_serial;
 };
 
-long operator-(const Date& d1, const Date& d2);
+/*  The function calculates the distance between two Dates.
+    d1 > d2 is allowed, which returns the negative of d2-d1.
+*/
+inline long operator-(const Date& d1, const Date& d2)
+{
+    return static_cast<long>(d1.serial()) - static_cast<long>(d2.serial());
+}
 
 inline double time_frac(const Date& d1, const Date& d2)
 {
     return static_cast<double>(d2 - d1) / 365.0;
 }
 
+// time_frac(d1, d2[i]) for all the dates in d2, in one vectorizable pass
+inline void time_frac(const Date& d1, std::span<const Date> d2, std::span<double> out)
+{
+    const long s1 = static_cast<long>(d1.serial());
+    const Date* d = d2.data();
+    double* o = out.data();
+    for (size_t i = 0, n = d2.size(); i < n; ++i)
+        o[i] = static_cast<double>(static_cast<long>(d[i].serial()) - s1) / 365.0;
+}
+
 } // namespace minirisk
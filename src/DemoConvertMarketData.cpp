@@ -0,0 +1,31 @@
+#include "MarketDataServer.h"
+
+#include <iostream>
+
+using namespace minirisk;
+
+int main(int argc, const char **argv)
+{
+    if (argc != 4 || (string(argv[3]) != "text" && string(argv[3]) != "snapshot")) {
+        std::cout << "This demo converts a market data file (in any format) to the given format.\n"
+                  << "Example:\n"
+                  << "DemoConvertMarketData risk_factors.txt risk_factors.bin snapshot\n"
+                  << "DemoConvertMarketData risk_factors.bin risk_factors.txt text\n";
+        return -1;
+    }
+
+    try {
+        MarketDataServer mds(argv[1]);
+        if (string(argv[3]) == "snapshot")
+            mds.save_snapshot(argv[2]);
+        else
+            mds.save(argv[2]);
+        std::cout << "Converted " << mds.symbols()->size() << " data points\n";
+    }
+    catch (const std::exception &e) {
+        std::cerr << e.what() << "\n";
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,29 @@
+#include "PortfolioUtils.h"
+
+using namespace minirisk;
+
+int main(int argc, const char **argv)
+{
+    if (argc != 4 || (string(argv[3]) != "text" && string(argv[3]) != "columns")) {
+        std::cout << "This demo converts a portfolio file (in any format) to the given format.\n"
+                  << "Example:\n"
+                  << "DemoConvertPortfolio portfolio.txt portfolio.bin columns\n"
+                  << "DemoConvertPortfolio portfolio.bin portfolio.txt text\n";
+        return -1;
+    }
+
+    try {
+        portfolio_t portfolio = load_portfolio(argv[1]);
+        if (string(argv[3]) == "columns")
+            save_portfolio_columns(argv[2], portfolio);
+        else
+            save_portfolio(argv[2], portfolio);
+        std::cout << "Converted " << portfolio.size() << " trades\n";
+    }
+    catch (const std::exception &e) {
+        std::cerr << e.what() << "\n";
+        return -1;
+    }
+
+    return 0;
+}
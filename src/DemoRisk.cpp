@@ -1,25 +1,79 @@
 #include <iostream>
 #include <algorithm>
+#include <map>
+#include <memory>
 
 #include "MarketDataServer.h"
 #include "PortfolioUtils.h"
+#include "ThreadPool.h"
+#include "PricerPaymentBatch.h"
+#include "PortfolioReader.h"
+#include "PortfolioColumns.h"
+#include "HistoricalVaR.h"
+#include "ExposureMC.h"
+#include "TradeBook.h"
+#include "Profiler.h"
 
 using namespace ::minirisk;
 
-void run(const string &portfolio_file, const string &risk_factors_file)
+// command line settings
+struct options_t
 {
+    string portfolio_file;
+    string risk_factors_file;
+    size_t n_threads = 1;  // threads used for pricing (1 means everything runs on the main thread)
+    bool aad = false;      // compute sensitivities via AAD rather than finite differences
+    bool batch = false;    // price payments in vectorized batches
+    size_t chunk_size = 0; // if positive, stream the portfolio in chunks of this many trades
+    string spill_file;     // in streaming mode, file receiving the results of each trade
+    bool df_cache = false; // memoize discount factors by date
+    string scenario_file;  // historical scenarios for VaR
+    size_t n_paths = 0;    // if positive, Monte Carlo paths of the exposure simulation
+    uint64_t seed = 1;     // seed of the exposure simulation
+    bool gamma = false;    // also compute FX delta, IR gamma and IR x FX cross gamma
+    bool profile = false;  // write timers, counters and allocations to profile.json
+};
+
+void print_df_cache_stats(const Market &mkt)
+{
+    if (const auto &stats = mkt.df_cache_stats())
+        std::cout << "DF cache: " << stats->hits() << " hits, " << stats->misses() << " misses\n";
+}
+
+void print_total(const string &name, double total)
+{
+    std::cout
+        << "========================\n"
+        << name << ":\n"
+        << "========================\n"
+        << "Total: " << total
+        << "\n========================\n\n";
+}
+
+void run(const options_t &opt)
+{
+    const string &portfolio_file = opt.portfolio_file;
+    const string &risk_factors_file = opt.risk_factors_file;
+
+    ThreadPool pool(opt.n_threads);
+
     // load the portfolio from file
-    portfolio_t portfolio = load_portfolio(portfolio_file);
-    // save and reload portfolio to implicitly test round trip serialization
-    save_portfolio("portfolio.tmp", portfolio);
-    portfolio.clear();
-    portfolio = load_portfolio("portfolio.tmp");
+    portfolio_t portfolio;
+    {
+        PROFILE_SCOPE("phase.load");
+        portfolio = load_portfolio(portfolio_file, &pool);
+        // save and reload portfolio to implicitly test round trip serialization
+        save_portfolio("portfolio.tmp", portfolio);
+        portfolio.clear();
+        portfolio = load_portfolio("portfolio.tmp", &pool);
+    }
 
     // display portfolio
     print_portfolio(portfolio);
 
-    // get pricers
-    std::vector<ppricer_t> pricers(get_pricers(portfolio));
+    // get pricers, stored contiguously by type
+    std::shared_ptr<PricerBook> pricer_book(PricerBook::create(portfolio));
+    std::vector<ppricer_t> pricers(pricer_book->pricers());
 
     // initialize market data server
     std::shared_ptr<const MarketDataServer> mds(new MarketDataServer(risk_factors_file));
@@ -27,17 +81,39 @@ void run(const string &portfolio_file, const string &risk_factors_file)
     // Init market object
     Date today(2017, 8, 5);
     Market mkt(mds, today);
+    if (opt.df_cache)
+        mkt.enable_df_cache();
 
-    // Price all products. Market objects are automatically constructed on demand,
-    // fetching data as needed from the market data server.
+    portfolio_dependencies_t deps;
+    portfolio_values_t prices;
     {
-        auto prices = compute_prices(pricers, mkt);
-        print_price_vector("PV", prices);
+        PROFILE_SCOPE("phase.price");
+
+        // resolve the market objects needed by each pricer once, so that pricing
+        // does no lookups by name, here and on the bumped copies of the market
+        bind_pricers(pricers, mkt);
+
+        // Price all products. Market objects are automatically constructed on demand,
+        // fetching data as needed from the market data server.
+        // Record the risk factors each trade depends on, so that risk runs only reprice
+        // the trades affected by each bump.
+        // The batch pricer does not record them, in which case compute_risk does.
+        // It reads the payments of a columnar file straight from the mapped columns.
+        if (!opt.batch)
+            prices = pricer_book->price(mkt, &pool, &deps);
+        else if (PortfolioColumns::is_columnar(portfolio_file))
+            prices = PricerPaymentBatch(PortfolioColumns(portfolio_file)).price(mkt, &pool);
+        else
+            prices = PricerPaymentBatch(pricers).price(mkt, &pool);
     }
+    print_price_vector("PV", prices);
 
     // disconnect the market (no more fetching from the market data server allowed)
     mkt.disconnect();
 
+    // all market objects have been built: publish the market as an immutable snapshot
+    mkt.freeze();
+
     // display all relevant risk factors
     {
         std::cout << "Risk factors:\n";
@@ -47,13 +123,181 @@ void run(const string &portfolio_file, const string &risk_factors_file)
         std::cout << "\n";
     }
 
-    {                                                                                        // Compute PV01 (i.e. sensitivity with respect to interest rate dV/dr)
-        std::vector<std::pair<string, portfolio_values_t>> pv01(compute_pv01(pricers, mkt)); // PV01 per trade
+    if (opt.aad)
+    { // Compute PV01 and FX delta in a single adjoint pass
+        std::vector<std::pair<string, portfolio_values_t>> sens;
+        {
+            PROFILE_SCOPE("phase.risk");
+            sens = compute_sensitivities_aad(pricers, mkt, &pool);
+        }
+
+        // display PV01 per currency, then FX delta per currency
+        for (const auto &g : sens)
+            if (g.first.compare(0, fx_spot_prefix.length(), fx_spot_prefix) != 0)
+                print_price_vector("PV01 " + g.first, g.second);
+        for (const auto &g : sens)
+            if (g.first.compare(0, fx_spot_prefix.length(), fx_spot_prefix) == 0)
+                print_price_vector("FX delta " + g.first, g.second);
+    }
+    else
+    { // Compute PV01 (i.e. sensitivity with respect to interest rate dV/dr) and, if requested,
+      // FX delta and second order IR sensitivities, in one sweep over the trades
+        const unsigned measures = opt.gamma ? risk_pv01 | risk_fx_delta | risk_gamma : risk_pv01;
+        fd_risk_t risk;
+        {
+            PROFILE_SCOPE("phase.risk");
+            risk = compute_risk(pricers, mkt, measures, &pool, opt.batch ? nullptr : &deps, &prices);
+        }
 
         // display PV01 per currency
-        for (const auto &g : pv01)
+        for (const auto &g : risk.pv01)
             print_price_vector("PV01 " + g.first, g.second);
+        for (const auto &g : risk.fx_delta)
+            print_price_vector("FX delta " + g.first, g.second);
+        for (const auto &g : risk.gamma)
+            print_price_vector("Gamma " + g.first, g.second);
+        for (const auto &g : risk.cross_gamma)
+            print_price_vector("Cross gamma " + g.first, g.second);
+    }
+
+    if (opt.scenario_file != "")
+    { // Historical VaR: revalue the portfolio under each scenario
+        PROFILE_SCOPE("phase.var");
+        scenario_set_t scenarios(load_scenarios(opt.scenario_file));
+        portfolio_values_t pnl(compute_scenario_pnl(pricers, mkt, scenarios, &pool, opt.batch ? nullptr : &deps));
+        print_price_vector("P&L", pnl);
+
+        std::cout
+            << "========================\n"
+            << "Historical VaR (" << scenarios.size() << " scenarios):\n"
+            << "========================\n";
+        for (double c : {0.95, 0.99})
+        {
+            var_t v = compute_var(pnl, c);
+            std::cout << "VaR " << 100 * c << "%: " << v.var << "\n"
+                      << "ES " << 100 * c << "%: " << v.es << "\n";
+        }
+        std::cout << "========================\n\n";
     }
+
+    if (opt.n_paths > 0)
+    { // Monte Carlo exposure profiles on a monthly grid
+        PROFILE_SCOPE("phase.exposure");
+        exposure_settings_t settings;
+        settings.dates = exposure_grid(pricers, today, 30);
+        settings.n_paths = opt.n_paths;
+        settings.seed = opt.seed;
+        settings.quantiles = {0.95, 0.99};
+        for (const auto &prof : compute_exposure(pricers, mkt, settings, &pool))
+        {
+            std::cout
+                << "========================\n"
+                << "Exposure " << prof.ccy << " (" << settings.n_paths << " paths):\n"
+                << "========================\n"
+                << "Date EE PFE 95% PFE 99%\n";
+            for (size_t j = 0; j < settings.dates.size(); ++j)
+                std::cout << settings.dates[j] << " " << prof.ee[j] << " " << prof.pfe[0][j] << " " << prof.pfe[1][j] << "\n";
+            std::cout << "========================\n\n";
+        }
+    }
+
+    print_df_cache_stats(mkt);
+}
+
+// Streaming risk run, for portfolios larger than memory.
+// The portfolio is read, priced and risked a chunk of trades at a time, and the
+// results are folded into running totals (and optionally spilled to file, one line
+// per trade and measure) before the next chunk is read. Memory use depends on the
+// chunk size and on the number of risk factors, not on the size of the portfolio.
+// The totals are accumulated in trade order, hence they are identical to the ones
+// of a run loading the whole portfolio.
+void run_stream(const options_t &opt)
+{
+    ThreadPool pool(opt.n_threads);
+
+    std::shared_ptr<const MarketDataServer> mds(new MarketDataServer(opt.risk_factors_file));
+    Date today(2017, 8, 5);
+    Market mkt(mds, today);
+    if (opt.df_cache)
+        mkt.enable_df_cache();
+
+    std::unique_ptr<my_ofstream> spill;
+    if (!opt.spill_file.empty())
+        spill.reset(new my_ofstream(opt.spill_file));
+
+    double pv_total = 0.0;
+    std::map<string, double> pv01_total;     // by IR risk factor
+    std::map<string, double> fx_delta_total; // by FX risk factor (AAD only)
+
+    PortfolioReader reader(opt.portfolio_file);
+    portfolio_t trades;
+    for (size_t first = reader.position(); reader.next(opt.chunk_size, trades); first = reader.position())
+    {
+        std::shared_ptr<PricerBook> pricer_book(PricerBook::create(trades));
+        std::vector<ppricer_t> pricers(pricer_book->pricers());
+        bind_pricers(pricers, mkt);
+
+        portfolio_dependencies_t deps;
+        portfolio_values_t prices;
+        std::vector<std::pair<string, portfolio_values_t>> sens;
+        {
+            PROFILE_SCOPE("phase.price");
+            prices = opt.batch
+                         ? PricerPaymentBatch(pricers).price(mkt, &pool)
+                         : pricer_book->price(mkt, &pool, &deps);
+        }
+        {
+            PROFILE_SCOPE("phase.risk");
+            sens = opt.aad
+                       ? compute_sensitivities_aad(pricers, mkt, &pool)
+                       : compute_pv01(pricers, mkt, &pool, opt.batch ? nullptr : &deps);
+        }
+
+        for (size_t i = 0; i < prices.size(); ++i)
+        {
+            pv_total += prices[i];
+            if (spill)
+            {
+                *spill << first + i << "PV" << prices[i];
+                spill->endl();
+            }
+        }
+        for (const auto &g : sens)
+        {
+            const bool fx = g.first.compare(0, fx_spot_prefix.length(), fx_spot_prefix) == 0;
+            double &total = (fx ? fx_delta_total : pv01_total)[g.first];
+            for (size_t i = 0; i < g.second.size(); ++i)
+            {
+                total += g.second[i];
+                if (spill && g.second[i] != 0.0)
+                {
+                    *spill << first + i << (fx ? "FX delta " : "PV01 ") + g.first << g.second[i];
+                    spill->endl();
+                }
+            }
+        }
+    }
+    if (spill)
+        spill->close();
+
+    std::cout << "Trades: " << reader.position() << "\n\n";
+
+    // display all relevant risk factors
+    {
+        std::cout << "Risk factors:\n";
+        auto tmp = mkt.get_risk_factors(".+");
+        for (const auto &iter : tmp)
+            std::cout << iter.first << "\n";
+        std::cout << "\n";
+    }
+
+    print_total("PV", pv_total);
+    for (const auto &t : pv01_total)
+        print_total("PV01 " + t.first, t.second);
+    for (const auto &t : fx_delta_total)
+        print_total("FX delta " + t.first, t.second);
+
+    print_df_cache_stats(mkt);
 }
 
 void usage()
@@ -61,33 +305,80 @@ void usage()
     std::cerr
         << "Invalid command line arguments\n"
         << "Example:\n"
-        << "DemoRisk -p portfolio.txt -f risk_factors.txt\n";
+        << "DemoRisk -p portfolio.txt -f risk_factors.txt [-t threads] [-s fd|aad] [-b 0|1] [-c chunk [-o spill.txt]] [-d 0|1] [-v scenarios.txt] [-e paths [-r seed]] [-g 0|1] [--profile]\n"
+        << "  -t  number of pricing threads, 0 for one per core (default 1)\n"
+        << "  -s  sensitivities via finite differences (default) or adjoint differentiation\n"
+        << "  -b  1 to price payments in vectorized batches (default 0)\n"
+        << "  -c  stream the portfolio in chunks of this many trades, reporting totals only\n"
+        << "  -o  in streaming mode, write the results of each trade to this file\n"
+        << "  -d  1 to cache discount factors by date and report cache hits (default 0)\n"
+        << "  -v  historical scenarios file, to compute the P&L under each scenario and the VaR\n"
+        << "  -e  number of Monte Carlo paths, to compute exposure profiles per currency\n"
+        << "  -r  seed of the Monte Carlo simulation (default 1)\n"
+        << "  -g  1 to also compute FX delta, IR gamma and IR x FX cross gamma by finite differences (default 0)\n"
+        << "  --profile  time each phase, count curve builds, market data fetches, reprices and heap allocations,\n"
+        << "             and write the report to profile.json\n";
     std::exit(-1);
 }
 
 int main(int argc, const char **argv)
 {
     // parse command line arguments
-    string portfolio, riskfactors;
-    if (argc % 2 == 0)
+    options_t opt;
+    std::vector<string> args; // key value pairs
+    for (int i = 1; i < argc; ++i)
+    {
+        if (string(argv[i]) == "--profile")
+            opt.profile = true;
+        else
+            args.push_back(argv[i]);
+    }
+    if (args.size() % 2 != 0)
         usage();
-    for (int i = 1; i < argc; i += 2)
+    for (size_t i = 0; i < args.size(); i += 2)
     {
-        string key(argv[i]);
-        string value(argv[i + 1]);
+        const string &key = args[i];
+        const string &value = args[i + 1];
         if (key == "-p")
-            portfolio = value;
+            opt.portfolio_file = value;
         else if (key == "-f")
-            riskfactors = value;
+            opt.risk_factors_file = value;
+        else if (key == "-t")
+            opt.n_threads = std::stoul(value);
+        else if (key == "-s" && (value == "fd" || value == "aad"))
+            opt.aad = value == "aad";
+        else if (key == "-b" && (value == "0" || value == "1"))
+            opt.batch = value == "1";
+        else if (key == "-c")
+            opt.chunk_size = std::stoul(value);
+        else if (key == "-o")
+            opt.spill_file = value;
+        else if (key == "-d" && (value == "0" || value == "1"))
+            opt.df_cache = value == "1";
+        else if (key == "-v")
+            opt.scenario_file = value;
+        else if (key == "-e")
+            opt.n_paths = std::stoul(value);
+        else if (key == "-r")
+            opt.seed = std::stoull(value);
+        else if (key == "-g" && (value == "0" || value == "1"))
+            opt.gamma = value == "1";
         else
             usage();
     }
-    if (portfolio == "" || riskfactors == "")
+    if (opt.portfolio_file == "" || opt.risk_factors_file == "" || (opt.spill_file != "" && opt.chunk_size == 0) || ((opt.scenario_file != "" || opt.n_paths > 0 || opt.gamma) && opt.chunk_size > 0))
         usage();
 
     try
     {
-        run(portfolio, riskfactors);
+        if (opt.profile)
+            profiler::enable();
+        if (opt.chunk_size > 0)
+            run_stream(opt);
+        else
+            run(opt);
+        if (opt.profile)
+            profiler::report("profile.json");
         return 0; // report success to the caller
     }
     catch (const std::exception &e)
@@ -0,0 +1,167 @@
+#include "ExposureMC.h"
+#include "CounterRNG.h"
+#include "Market.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+namespace minirisk {
+
+namespace {
+
+// paths simulated and revalued together by one task
+const size_t path_block = 16;
+
+} // anonymous namespace
+
+std::vector<Date> exposure_grid(const std::vector<ppricer_t>& pricers, const Date& today, unsigned step_days)
+{
+    MYASSERT(step_days > 0, "The exposure grid step must be positive");
+    Date last = today;
+    for (const auto& p : pricers)
+        last = std::max(last, p->maturity());
+
+    std::vector<Date> res;
+    for (unsigned s = today.serial() + step_days; s <= last.serial(); s += step_days)
+        res.push_back(Date(s));
+    if (res.empty() || res.back() < last)
+        res.push_back(last);
+    return res;
+}
+
+std::vector<exposure_profile_t> compute_exposure(const std::vector<ppricer_t>& pricers, const Market& mkt, const exposure_settings_t& settings, ThreadPool* pool)
+{
+    PROFILE_SCOPE("exposure.simulate");
+    const std::vector<Date>& dates = settings.dates;
+    const size_t n_dates = dates.size();
+    const size_t n_paths = settings.n_paths;
+    MYASSERT(n_paths > 0, "Exposure simulation requires at least one path");
+    for (size_t j = 0; j < n_dates; ++j)
+        MYASSERT(mkt.today() < dates[j] && (j == 0 || dates[j - 1] < dates[j]), "Exposure dates must be increasing and after today");
+    for (double q : settings.quantiles)
+        MYASSERT(q > 0.0 && q < 1.0, "Quantiles must be between 0 and 1, got " << q);
+
+    // one driver per IR currency and per FX spot
+    const Market::vec_risk_factor_t factors = mkt.get_risk_factors(".+");
+    std::map<string, size_t> drivers;
+    std::vector<size_t> driver(factors.size());
+    std::vector<bool> is_fx(factors.size());
+    for (size_t i = 0; i < factors.size(); ++i) {
+        const string& name = factors[i].first;
+        is_fx[i] = name.compare(0, fx_spot_prefix.length(), fx_spot_prefix) == 0;
+        MYASSERT(is_fx[i] || name.compare(0, ir_rate_prefix.length(), ir_rate_prefix) == 0, "No model to simulate risk factor " << name);
+        const string key = is_fx[i] ? name : name.substr(name.length() - 3);
+        driver[i] = drivers.emplace(key, drivers.size()).first->second;
+    }
+    const size_t n_drivers = drivers.size();
+
+    // netting by currency
+    std::map<string, size_t> groups;
+    std::vector<size_t> group(pricers.size());
+    for (size_t t = 0; t < pricers.size(); ++t)
+        groups.emplace(pricers[t]->ccy(), 0);
+    size_t n_groups = 0;
+    for (auto& g : groups)
+        g.second = n_groups++;
+    for (size_t t = 0; t < pricers.size(); ++t)
+        group[t] = groups[pricers[t]->ccy()];
+
+    // at each date, the trades still alive and a market seen from that date
+    std::vector<std::vector<size_t>> alive(n_dates);
+    std::vector<Market> date_mkt;
+    date_mkt.reserve(n_dates);
+    std::vector<double> t(n_dates), sqrt_dt(n_dates);
+    for (size_t j = 0; j < n_dates; ++j) {
+        for (size_t i = 0; i < pricers.size(); ++i)
+            if (!(pricers[i]->maturity() < dates[j]))
+                alive[j].push_back(i);
+        date_mkt.emplace_back(mkt, dates[j]);
+        t[j] = time_frac(mkt.today(), dates[j]);
+        sqrt_dt[j] = std::sqrt(t[j] - (j > 0 ? t[j - 1] : 0.0));
+    }
+
+    // exposure of each date, currency and path
+    std::vector<double> exposure(n_dates * n_groups * n_paths, 0.0);
+    auto at = [&](size_t j, size_t g, size_t p) -> double& { return exposure[(j * n_groups + g) * n_paths + p]; };
+
+    const CounterRNG rng(settings.seed);
+    const size_t n_blocks = (n_paths + path_block - 1) / path_block;
+
+    auto simulate = [&](size_t begin, size_t end)
+    {
+        std::vector<double> w(n_drivers * path_block); // Brownian motion of each driver and path
+        std::vector<double> v(n_groups * path_block);  // value of each currency and path
+        for (size_t b = begin; b < end; ++b) {
+            const size_t p0 = b * path_block;
+            const size_t n = std::min(path_block, n_paths - p0);
+            std::fill(w.begin(), w.end(), 0.0);
+
+            for (size_t j = 0; j < n_dates; ++j) {
+                // advance all the drivers of all the paths of the block
+                for (size_t d = 0; d < n_drivers; ++d)
+                    for (size_t k = 0; k < n; ++k)
+                        w[d * path_block + k] += sqrt_dt[j] * rng.normal({ { uint32_t(p0 + k), uint32_t(j), uint32_t(d), 0 } });
+
+                // one market per path; curves are rebuilt lazily by the first trade using them
+                std::vector<Market> markets(n, date_mkt[j]);
+                for (size_t k = 0; k < n; ++k) {
+                    Market::vec_risk_factor_t simulated(factors);
+                    for (size_t i = 0; i < simulated.size(); ++i) {
+                        const double x = w[driver[i] * path_block + k];
+                        if (is_fx[i])
+                            simulated[i].second *= std::exp(settings.fx_vol * x - 0.5 * settings.fx_vol * settings.fx_vol * t[j]);
+                        else
+                            simulated[i].second += settings.ir_vol * x;
+                    }
+                    markets[k].set_risk_factors(simulated);
+                }
+
+                // trade major: price each trade under all the paths while its data is hot
+                std::fill(v.begin(), v.end(), 0.0);
+                for (size_t i : alive[j])
+                    for (size_t k = 0; k < n; ++k)
+                        v[group[i] * path_block + k] += pricers[i]->price(markets[k]);
+                PROFILE_COUNT("exposure.reprices", alive[j].size() * n);
+
+                for (size_t g = 0; g < n_groups; ++g)
+                    for (size_t k = 0; k < n; ++k)
+                        at(j, g, p0 + k) = std::max(v[g * path_block + k], 0.0);
+            }
+        }
+    };
+
+    if (pool_size(pool) == 1)
+        simulate(0, n_blocks);
+    else
+        pool->parallel_for(n_blocks, 1, simulate);
+
+    // reduce across paths, in path order
+    std::vector<exposure_profile_t> res(n_groups);
+    std::vector<double> sorted(n_paths);
+    for (const auto& g : groups) {
+        exposure_profile_t& prof = res[g.second];
+        prof.ccy = g.first;
+        prof.ee.resize(n_dates);
+        prof.pfe.assign(settings.quantiles.size(), std::vector<double>(n_dates));
+        for (size_t j = 0; j < n_dates; ++j) {
+            const double* e = &at(j, g.second, 0);
+            double sum = 0.0;
+            for (size_t p = 0; p < n_paths; ++p)
+                sum += e[p];
+            prof.ee[j] = sum / n_paths;
+
+            sorted.assign(e, e + n_paths);
+            std::sort(sorted.begin(), sorted.end());
+            for (size_t q = 0; q < settings.quantiles.size(); ++q) {
+                size_t k = size_t(std::ceil(n_paths * settings.quantiles[q] - 1e-9));
+                prof.pfe[q][j] = sorted[std::clamp<size_t>(k, 1, n_paths) - 1];
+            }
+        }
+    }
+    return res;
+}
+
+} // namespace minirisk
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Date.h"
+#include "PortfolioUtils.h"
+
+namespace minirisk {
+
+struct Market;
+struct ThreadPool;
+
+// Monte Carlo exposure simulation.
+// Risk factors are simulated forward from today on a grid of dates:
+// - interest rates follow an arithmetic Brownian motion; all the rates of a
+//   currency (flat rate and tenor pillars) move together, i.e. the curve shifts in parallel
+// - FX spots follow a driftless geometric Brownian motion
+// Each currency curve and each FX spot has its own independent driver.
+struct exposure_settings_t
+{
+    std::vector<Date> dates;                  // simulation grid, increasing, after today
+    size_t n_paths = 1000;
+    uint64_t seed = 1;
+    double ir_vol = 0.01;                     // normal volatility of rates, per year
+    double fx_vol = 0.10;                     // lognormal volatility of FX spots, per year
+    std::vector<double> quantiles = { 0.95 }; // of the potential future exposure
+};
+
+// exposure of the trades settled in one currency, in USD
+struct exposure_profile_t
+{
+    string ccy;
+    std::vector<double> ee;               // expected exposure, one value per grid date
+    std::vector<std::vector<double>> pfe; // potential future exposure, one profile per quantile
+};
+
+// grid of dates every step_days from today, up to the last maturity of the trades
+std::vector<Date> exposure_grid(const std::vector<ppricer_t>& pricers, const Date& today, unsigned step_days);
+
+// Simulate settings.n_paths paths and revalue, at each grid date, all the trades
+// which have not matured under the market of each path. The exposure of a
+// currency is the positive part of the value of all its trades on a path.
+// Pricers should be bound to mkt (see bind_pricers).
+// Paths are simulated and revalued in blocks, spread across the threads of the pool;
+// the trades are walked once per block and date. Random numbers are drawn from a
+// counter based generator keyed by path, date and driver, hence the result does not
+// depend on the number of threads. Only the exposure of each path, date and currency
+// is kept, so memory does not grow with the number of trades.
+std::vector<exposure_profile_t> compute_exposure(const std::vector<ppricer_t>& pricers, const Market& mkt, const exposure_settings_t& settings, ThreadPool* pool = nullptr);
+
+} // namespace minirisk
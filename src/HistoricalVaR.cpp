@@ -0,0 +1,132 @@
+#include "HistoricalVaR.h"
+#include "Market.h"
+#include "Streamer.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace minirisk {
+
+namespace {
+
+// scenarios revalued together by one task
+const size_t scenario_batch = 16;
+
+} // anonymous namespace
+
+scenario_set_t load_scenarios(const string& filename)
+{
+    scenario_set_t res;
+    my_ifstream is(filename);
+
+    // header
+    MYASSERT(is.read_line(), "Empty scenario file " << filename);
+    string name;
+    is >> name;
+    MYASSERT(name == "date", "Scenario file " << filename << " must start with a date column");
+    for (std::string_view tok = is.read_token(); !tok.empty(); tok = is.read_token())
+        res.risk_factors.emplace_back(tok);
+    MYASSERT(!res.risk_factors.empty(), "Scenario file " << filename << " has no risk factors");
+
+    // one row per date
+    while (is.read_line()) {
+        Date d;
+        is >> d;
+        res.dates.push_back(d);
+        for (size_t j = 0; j < res.risk_factors.size(); ++j) {
+            double v;
+            is >> v;
+            res.shifts.push_back(v);
+        }
+    }
+    return res;
+}
+
+portfolio_values_t compute_scenario_pnl(const std::vector<ppricer_t>& pricers, const Market& mkt, const scenario_set_t& scenarios, ThreadPool* pool, const portfolio_dependencies_t* deps)
+{
+    PROFILE_SCOPE("var.scenario_pnl");
+
+    // record which trades read which risk factors, unless the caller already did
+    portfolio_dependencies_t recorded;
+    portfolio_values_t base;
+    {
+        Market tmpmkt(mkt);
+        base = compute_prices(pricers, tmpmkt, pool, deps ? nullptr : &recorded);
+    }
+    if (!deps)
+        deps = &recorded;
+
+    // scenario columns of the risk factors in the market, with their base values
+    std::vector<size_t> columns;
+    Market::vec_risk_factor_t factors;
+    for (const auto& d : mkt.get_risk_factors(".+")) {
+        auto i = std::find(scenarios.risk_factors.begin(), scenarios.risk_factors.end(), d.first);
+        if (i != scenarios.risk_factors.end()) {
+            columns.push_back(size_t(i - scenarios.risk_factors.begin()));
+            factors.push_back(d);
+        }
+    }
+
+    // trades depending on any of the shifted risk factors
+    std::vector<size_t> affected;
+    for (size_t t = 0; t < pricers.size(); ++t)
+        for (const auto& f : factors)
+            if (std::find((*deps)[t].begin(), (*deps)[t].end(), f.first) != (*deps)[t].end()) {
+                affected.push_back(t);
+                break;
+            }
+
+    portfolio_values_t pnl(scenarios.size(), 0.0);
+    const size_t n_batches = (scenarios.size() + scenario_batch - 1) / scenario_batch;
+
+    auto revalue = [&](size_t begin, size_t end)
+    {
+        for (size_t b = begin; b < end; ++b) {
+            const size_t s0 = b * scenario_batch;
+            const size_t n = std::min(scenario_batch, scenarios.size() - s0);
+
+            // one market per scenario of the batch; curves are rebuilt lazily by the first trade using them
+            std::vector<Market> markets(n, mkt);
+            for (size_t k = 0; k < n; ++k) {
+                std::span<const double> shifts = scenarios.row(s0 + k);
+                Market::vec_risk_factor_t shifted(factors);
+                for (size_t j = 0; j < shifted.size(); ++j)
+                    shifted[j].second += shifts[columns[j]];
+                markets[k].set_risk_factors(shifted);
+            }
+
+            // trade major: price each trade under all the scenarios while its data is hot
+            for (size_t t : affected)
+                for (size_t k = 0; k < n; ++k)
+                    pnl[s0 + k] += pricers[t]->price(markets[k]) - base[t];
+            PROFILE_COUNT("var.reprices", affected.size() * n);
+        }
+    };
+
+    if (pool_size(pool) == 1)
+        revalue(0, n_batches);
+    else
+        pool->parallel_for(n_batches, 1, revalue);
+
+    return pnl;
+}
+
+var_t compute_var(const portfolio_values_t& pnl, double confidence)
+{
+    MYASSERT(!pnl.empty(), "Cannot compute VaR without scenarios");
+    MYASSERT(confidence > 0.0 && confidence < 1.0, "Confidence must be between 0 and 1, got " << confidence);
+    size_t k = size_t(std::ceil(pnl.size() * (1.0 - confidence) - 1e-9));
+    k = std::clamp<size_t>(k, 1, pnl.size());
+
+    // the k worst outcomes, sorted
+    portfolio_values_t worst(pnl);
+    std::partial_sort(worst.begin(), worst.begin() + k, worst.end());
+    double tail = 0.0;
+    for (size_t i = 0; i < k; ++i)
+        tail += worst[i];
+    return var_t{ confidence, -worst[k - 1], -tail / k };
+}
+
+} // namespace minirisk
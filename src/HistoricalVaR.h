@@ -0,0 +1,58 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include "Date.h"
+#include "PortfolioUtils.h"
+
+namespace minirisk {
+
+struct Market;
+struct ThreadPool;
+
+// Historical scenarios: absolute shifts of a set of risk factors, one row per date.
+// File format, with fields separated by ';':
+//   date;<risk factor 1>;...;<risk factor n>;
+//   <YYYYMMDD>;<shift 1>;...;<shift n>;
+//   ...
+struct scenario_set_t
+{
+    std::vector<Date> dates;
+    std::vector<string> risk_factors;
+    std::vector<double> shifts; // row major, one row of risk_factors.size() values per date
+
+    size_t size() const { return dates.size(); }
+
+    std::span<const double> row(size_t i) const
+    {
+        return std::span<const double>(shifts.data() + i * risk_factors.size(), risk_factors.size());
+    }
+};
+
+scenario_set_t load_scenarios(const string& filename);
+
+// Profit and loss of the portfolio under each scenario, i.e. its value with the risk
+// factors shifted by the scenario minus its value in mkt. Risk factors which are not in
+// the market (i.e. no trade depends on them) are ignored.
+// Scenarios are revalued in batches, spread across the threads of the pool. Each batch
+// builds one copy of the market per scenario, then walks the trades once, pricing each
+// trade under all the scenarios of the batch. Only the trades depending on the shifted
+// risk factors are repriced. Dependencies are taken from deps, as recorded by
+// compute_prices; if not provided, they are recorded with an additional pricing pass.
+// The result does not depend on the number of threads.
+portfolio_values_t compute_scenario_pnl(const std::vector<ppricer_t>& pricers, const Market& mkt, const scenario_set_t& scenarios, ThreadPool* pool = nullptr, const portfolio_dependencies_t* deps = nullptr);
+
+// Value at risk and expected shortfall of a P&L distribution, as positive losses.
+// With n scenarios, the VaR at confidence c is the k-th worst loss, where k = ceil(n * (1 - c)),
+// and the ES is the average of the k worst losses.
+struct var_t
+{
+    double confidence;
+    double var;
+    double es;
+};
+
+var_t compute_var(const portfolio_values_t& pnl, double confidence);
+
+} // namespace minirisk
@@ -1,10 +1,12 @@
 #pragma once
 
 #include <memory>
+#include <span>
 #include <string>
 
 #include "IObject.h"
 #include "Date.h"
+#include "AAD.h"
 
 using std::string;
 
@@ -30,6 +32,17 @@ struct ICurveDiscount : ICurve
 {
     // compute the discount factor for date t
     virtual double df(const Date& t) const = 0;
+
+    // as above, recording the calculation on a tape for adjoint differentiation
+    virtual ADouble df(const Date& t, Tape& tape) const = 0;
+
+    // compute the discount factors for many dates at once: out[i] = df(t[i]).
+    // Curves can override this with a vectorized implementation.
+    virtual void df(std::span<const Date> t, std::span<double> out) const
+    {
+        for (size_t i = 0; i < t.size(); ++i)
+            out[i] = df(t[i]);
+    }
 };
 
 struct ICurveFXForward : ICurve
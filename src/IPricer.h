@@ -10,6 +10,21 @@ namespace minirisk {
 struct IPricer : IObject
 {
     virtual double price(Market& m) const = 0;
+
+    // price recording the calculation on a tape, so that the sensitivities with
+    // respect to all risk factors can be obtained with Tape::backward
+    virtual ADouble price(Market& m, Tape& tape) const = 0;
+
+    // resolve the market objects used by the pricer to handles (see Market::bind_*),
+    // so that pricing m and its copies does not need to look them up by name.
+    // Must not be called concurrently with price.
+    virtual void bind(Market& m) const {}
+
+    // last date on which the trade has cash flows: it has no value after that date
+    virtual Date maturity() const = 0;
+
+    // currency in which the trade is settled
+    virtual const string& ccy() const = 0;
 };
 
 
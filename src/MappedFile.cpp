@@ -0,0 +1,65 @@
+#include "MappedFile.h"
+#include "Macros.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MINIRISK_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+namespace minirisk {
+
+#ifdef MINIRISK_MMAP
+
+MappedFile::MappedFile(const string& filename)
+    : m_data(nullptr)
+    , m_size(0)
+{
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    MYASSERT(fd >= 0, "Could not open file " << filename);
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        THROW("Could not read size of file " << filename);
+    }
+    m_size = size_t(st.st_size);
+    if (m_size > 0) {
+        void* p = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        MYASSERT(p != MAP_FAILED, "Could not map file " << filename);
+        m_data = static_cast<const char*>(p);
+    }
+    else
+        ::close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_size > 0)
+        ::munmap(const_cast<char*>(m_data), m_size);
+}
+
+#else
+
+MappedFile::MappedFile(const string& filename)
+{
+    std::ifstream is(filename, std::ios::binary | std::ios::ate);
+    MYASSERT(!is.fail(), "Could not open file " << filename);
+    m_buffer.resize(size_t(is.tellg()));
+    is.seekg(0);
+    is.read(m_buffer.data(), m_buffer.size());
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+}
+
+MappedFile::~MappedFile()
+{
+}
+
+#endif
+
+} // namespace minirisk
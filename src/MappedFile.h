@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Global.h"
+
+namespace minirisk {
+
+// Read-only view of the whole content of a file.
+// On POSIX systems the file is memory mapped, so that opening it costs nothing
+// and pages are loaded by the OS on first access. Elsewhere the file is read
+// into memory.
+struct MappedFile
+{
+    MappedFile(const string& filename);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    const char* m_data;
+    size_t m_size;
+    std::vector<char> m_buffer; // used when memory mapping is not available
+};
+
+} // namespace minirisk
@@ -1,18 +1,95 @@
 #include "Market.h"
 #include "CurveDiscount.h"
+#include "Profiler.h"
 
 #include <vector>
 #include <limits>
+#include <algorithm>
 
 namespace minirisk {
 
+namespace {
+
+// source of layout ids, 0 is reserved for "not bound"
+std::atomic<size_t> s_next_layout_id(1);
+
+template <typename T>
+ICurve* make_curve(Market* mkt, const Date& today, const string& name)
+{
+    return new T(mkt, today, name);
+}
+
+} // anonymous namespace
+
+Market::Market(const std::shared_ptr<const MarketDataServer>& mds, const Date& today)
+    : m_today(today)
+    , m_mds(mds)
+    , m_frozen(false)
+    , m_layout_id(s_next_layout_id++)
+    , m_shared_layout(false)
+{
+    MYASSERT(m_mds, "A market requires a market data server");
+    m_symbols = m_mds->symbols();
+    m_values.assign(m_symbols->size(), std::numeric_limits<double>::quiet_NaN());
+}
+
+Market::Market(const Market& other)
+    : m_today(other.m_today)
+    , m_mds(other.m_mds)
+    , m_frozen(false)
+    , m_layout_id(other.layout_id())
+    , m_shared_layout(true)
+    , m_curves(other.m_curves)
+    , m_symbols(other.m_symbols)
+    , m_df_stats(other.m_df_stats)
+{
+    other.m_shared_layout.store(true);
+    std::lock_guard<std::mutex> lock(other.m_fetch);
+    m_values = other.m_values;
+}
+
+Market::Market(const Market& other, const Date& today)
+    : Market(other)
+{
+    m_today = today;
+    clear();
+}
+
+Market::curve_slot& Market::built_slot(size_t handle)
+{
+    curve_slot& slot = m_curves.at(handle);
+    if (!slot.m_ready.load(std::memory_order_acquire)) {
+        const string& name = m_curves.name(handle);
+        MYASSERT(!m_frozen, "Cannot build curve " << name << " because the market is frozen");
+        std::lock_guard<std::mutex> lock(slot.m_build);
+        if (!slot.m_ready.load(std::memory_order_relaxed)) { // not built by another thread meanwhile
+            PROFILE_SCOPE("market.curve_build");
+            risk_factor_names_t deps;
+            {
+                dependency_recorder rec(deps);
+                slot.m_curve.reset(slot.m_factory(this, m_today, name));
+            }
+            slot.m_deps.swap(deps);
+            slot.m_ready.store(slot.m_curve.get(), std::memory_order_release);
+        }
+    }
+    // whoever uses the curve depends on the risk factors it was built from
+    dependency_recorder::add(slot.m_deps);
+    return slot;
+}
+
 template <typename I, typename T>
 std::shared_ptr<const I> Market::get_curve(const string& name)
 {
-    ptr_curve_t& curve_ptr = m_curves[name];
-    if (!curve_ptr.get())
-        curve_ptr.reset(new T(this, m_today, name));
-    std::shared_ptr<const I> res = std::dynamic_pointer_cast<const I>(curve_ptr);
+    size_t handle = m_curves.find_id(name);
+    if (handle == m_curves.npos) {
+        handle = m_curves.find_or_insert_id(name, &make_curve<T>);
+        // the new handle is unknown to the copies sharing our layout id
+        if (m_shared_layout.exchange(false))
+            m_layout_id.store(s_next_layout_id++, std::memory_order_release);
+    }
+    curve_slot& slot = built_slot(handle);
+    std::shared_ptr<const I> res = std::dynamic_pointer_cast<const I>(slot.m_curve);
     MYASSERT(res, "Cannot cast object with name " << name << " to type " << typeid(I).name());
     return res;
 }
@@ -22,14 +99,27 @@ const ptr_disc_curve_t Market::get_discount_curve(const string& name)
     return get_curve<ICurveDiscount, CurveDiscount>(name);
 }
 
-double Market::from_mds(const string& objtype, const string& name)
+size_t Market::fetch(const string& objtype, const string& name)
 {
-    auto ins = m_risk_factors.emplace(name, std::numeric_limits<double>::quiet_NaN());
-    if (ins.second) { // just inserted, need to be populated
+    dependency_recorder::add(name);
+    size_t id = m_symbols->find(name);
+    MYASSERT(id != SymbolTable::npos, "Market data not found: " << name);
+    if (!std::isnan(std::atomic_ref<double>(m_values[id]).load(std::memory_order_acquire)))
+        return id;
+    MYASSERT(!m_frozen, "Cannot fetch " << objtype << " " << name << " because the market is frozen");
+    std::lock_guard<std::mutex> lock(m_fetch);
+    if (std::isnan(m_values[id])) { // not fetched by another thread meanwhile
         MYASSERT(m_mds, "Cannot fetch " << objtype << " " << name << " because the market data server has been disconnnected");
-        ins.first->second = m_mds->get(name);
+        PROFILE_COUNT("market.mds_fetches", 1);
+        std::atomic_ref<double>(m_values[id]).store(m_mds->get(id), std::memory_order_release);
     }
-    return ins.first->second;
+    return id;
+}
+
+double Market::from_mds(const string& objtype, const string& name)
+{
+    PROFILE_COUNT("market.mds_lookups", 1);
+    return m_values[fetch(objtype, name)];
 }
 
 const double Market::get_yield(const string& ccyname)
@@ -38,28 +128,126 @@ const double Market::get_yield(const string& ccyname)
     return from_mds("yield curve", name);
 };
 
+Market::vec_risk_factor_t Market::get_yield_pillars(const string& ccyname)
+{
+    vec_risk_factor_t result;
+    for (size_t id : RiskFactorSelector(ir_rate_prefix + "[0-9]+[DWMY]\\." + ccyname).select(*m_symbols)) {
+        const string name(m_symbols->name(id));
+        result.emplace_back(name, m_values[fetch("yield curve", name)]);
+    }
+    return result;
+}
+
 const double Market::get_fx_spot(const string& name)
 {
     return from_mds("fx spot", mds_spot_name(name));
 }
 
+size_t Market::bind_discount_curve(const string& name)
+{
+    get_discount_curve(name); // builds the curve and checks its type
+    return m_curves.find_id(name);
+}
+
+size_t Market::bind_yield(const string& ccyname)
+{
+    return fetch("yield curve", ir_rate_prefix + ccyname);
+}
+
+size_t Market::bind_fx_spot(const string& name)
+{
+    return fetch("fx spot", mds_spot_name(name));
+}
+
+ADouble Market::get_yield(const string& ccyname, Tape& tape)
+{
+    return tape.input(ir_rate_prefix + ccyname, get_yield(ccyname));
+}
+
+ADouble Market::get_fx_spot(const string& name, Tape& tape)
+{
+    return tape.input(mds_spot_name(name), get_fx_spot(name));
+}
+
+void Market::clear()
+{
+    MYASSERT(!m_frozen, "Cannot clear a frozen market");
+    m_curves.reclaim();
+    m_curves.for_each([](const string&, curve_slot& slot) {
+        if (slot.m_ready.load())
+            PROFILE_COUNT("market.curve_clears", 1);
+        slot.reset();
+    });
+}
+
 void Market::set_risk_factors(const vec_risk_factor_t& risk_factors)
 {
-    clear();
+    MYASSERT(!m_frozen, "Cannot modify a frozen market");
+    m_curves.reclaim();
     for (const auto& d : risk_factors) {
-        auto i = m_risk_factors.find(d.first);
-        MYASSERT((i != m_risk_factors.end()), "Risk factor not found " << d.first);
-        i->second = d.second;
+        size_t id = m_symbols->find(d.first);
+        MYASSERT((id != SymbolTable::npos && !std::isnan(m_values[id])), "Risk factor not found " << d.first);
+        m_values[id] = d.second;
     }
+
+    // only the curves built from the modified risk factors need to be rebuilt
+    m_curves.for_each([&risk_factors](const string&, curve_slot& slot) {
+        for (const auto& d : risk_factors)
+            if (std::find(slot.m_deps.begin(), slot.m_deps.end(), d.first) != slot.m_deps.end()) {
+                PROFILE_COUNT("market.curve_clears", 1);
+                slot.reset();
+                return;
+            }
+    });
+}
+
+namespace {
+
+// innermost recorder active on the current thread
+thread_local Market::dependency_recorder* t_recorder = nullptr;
+
+} // anonymous namespace
+
+Market::dependency_recorder::dependency_recorder(risk_factor_names_t& deps)
+    : m_deps(deps)
+    , m_outer(t_recorder)
+{
+    t_recorder = this;
+}
+
+Market::dependency_recorder::~dependency_recorder()
+{
+    t_recorder = m_outer;
+}
+
+bool Market::dependency_recorder::active()
+{
+    return t_recorder != nullptr;
+}
+
+void Market::dependency_recorder::add(std::string_view name)
+{
+    if (!t_recorder)
+        return;
+    risk_factor_names_t& deps = t_recorder->m_deps;
+    if (std::find(deps.begin(), deps.end(), name) == deps.end())
+        deps.emplace_back(name);
+}
+
+void Market::dependency_recorder::add(const risk_factor_names_t& names)
+{
+    if (!t_recorder)
+        return;
+    for (const auto& n : names)
+        add(n);
 }
 
-Market::vec_risk_factor_t Market::get_risk_factors(const std::string& expr) const
+Market::vec_risk_factor_t Market::get_risk_factors(const RiskFactorSelector& sel) const
 {
     vec_risk_factor_t result;
-    std::regex r(expr);
-    for (const auto& d : m_risk_factors)
-        if (std::regex_match(d.first, r))
-            result.push_back(d);
+    for (size_t id : sel.select(*m_symbols))
+        if (!std::isnan(m_values[id]))
+            result.emplace_back(m_symbols->name(id), m_values[id]);
     return result;
 }
 
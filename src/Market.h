@@ -4,8 +4,13 @@
 #include "IObject.h"
 #include "ICurve.h"
 #include "MarketDataServer.h"
+#include "ConcurrentIndex.h"
+#include "DFCache.h"
+#include "RiskFactorSelector.h"
 #include <vector>
-#include <regex>
+#include <mutex>
+#include <atomic>
+#include <cmath>
 
 namespace minirisk
 {
@@ -13,20 +18,60 @@ namespace minirisk
     struct Market : IObject
     {
     private:
-        // NOTE: this function is not thread safe
+        // NOTE: curves and risk factors are populated lazily, but lookups of existing
+        // objects never lock and each curve is built exactly once, even when several
+        // pricers request it concurrently. Methods which modify the market
+        // (clear, set_risk_factors, disconnect, freeze) must not run concurrently with
+        // pricing; they also free the lookup tables retired by the curve index.
         template <typename I, typename T>
         std::shared_ptr<const I> get_curve(const string &name);
 
         double from_mds(const string &objtype, const string &name);
 
+        // id of a risk factor, fetching its value from the market data server if needed
+        size_t fetch(const string &objtype, const string &name);
+
+        struct curve_slot;
+        curve_slot &built_slot(size_t handle);
+
     public:
         typedef std::pair<string, double> risk_factor_t;
         typedef std::vector<std::pair<string, double>> vec_risk_factor_t;
+        typedef std::vector<string> risk_factor_names_t;
 
-        Market(const std::shared_ptr<const MarketDataServer> &mds, const Date &today)
-            : m_today(today), m_mds(mds)
+        // While an object of this type is alive, all the risk factors read by the
+        // current thread through any market (directly or via the curves it uses)
+        // are added to the given set. Recorders can be nested, e.g. a curve records
+        // its own inputs while it is being built during the pricing of a trade.
+        struct dependency_recorder
         {
-        }
+            dependency_recorder(risk_factor_names_t &deps);
+            ~dependency_recorder();
+
+            dependency_recorder(const dependency_recorder &) = delete;
+            dependency_recorder &operator=(const dependency_recorder &) = delete;
+
+            // add names to the set of the innermost active recorder, if any
+            static void add(std::string_view name);
+            static void add(const risk_factor_names_t &names);
+
+            // true if a recorder is active on the current thread
+            static bool active();
+
+        private:
+            risk_factor_names_t &m_deps;
+            dependency_recorder *m_outer;
+        };
+
+        Market(const std::shared_ptr<const MarketDataServer> &mds, const Date &today);
+
+        // copying a market shares the curve objects, which are immutable.
+        // The copy is never frozen, so that it can be bumped.
+        Market(const Market &other);
+
+        // copy of a market seen from another date: same data points and handles,
+        // but all curves are rebuilt on demand relative to the new date
+        Market(const Market &other, const Date &today);
 
         virtual Date today() const { return m_today; }
 
@@ -39,35 +84,136 @@ namespace minirisk
         // fx exchange rate to convert 1 unit of ccy1 into USD
         const double get_fx_spot(const string &ccy);
 
+        // tenor yield rates IR.<tenor>.<ccy> for currency name, empty if the market has none
+        vec_risk_factor_t get_yield_pillars(const string &name);
+
+        // as above, registering the risk factor as an input of the tape
+        ADouble get_yield(const string &name, Tape &tape);
+        ADouble get_fx_spot(const string &ccy, Tape &tape);
+
+        // memoize the discount factors of the curves built from now on, by date.
+        // Copies of the market share the hit and miss counters.
+        void enable_df_cache()
+        {
+            if (!m_df_stats)
+                m_df_stats.reset(new DFCacheStats);
+        }
+
+        // counters of the discount factor caches, null if caching is disabled
+        const std::shared_ptr<DFCacheStats> &df_cache_stats() const
+        {
+            return m_df_stats;
+        }
+
+        //
+        // Binding: pricers can resolve the objects they need to integer handles once,
+        // and then access them without any string lookup, allocation or RTTI.
+        // Handles remain valid for copies of the market made after binding.
+        //
+
+        // identifies the markets sharing the same handles (i.e. copies of each other).
+        // A market adding a curve after being copied takes a new id.
+        size_t layout_id() const { return m_layout_id.load(std::memory_order_acquire); }
+
+        // handle of a discount curve, building the curve if needed
+        size_t bind_discount_curve(const string &name);
+
+        // handles of the risk factors returned by get_yield and get_fx_spot
+        size_t bind_yield(const string &ccy);
+        size_t bind_fx_spot(const string &ccy);
+
+        // access by handle. Curves invalidated by set_risk_factors are rebuilt on demand.
+        const ICurveDiscount *discount_curve(size_t handle)
+        {
+            return static_cast<const ICurveDiscount *>(built_slot(handle).m_ready.load(std::memory_order_relaxed));
+        }
+
+        double risk_factor(size_t handle) const
+        {
+            if (dependency_recorder::active())
+                dependency_recorder::add(m_symbols->name(handle));
+            return m_values[handle];
+        }
+
         // after the market has been disconnected, it is no more possible to fetch
         // new data points from the market data server
         void disconnect()
         {
             m_mds.reset();
+            m_curves.reclaim();
         }
 
-        // returns risk factors matching a regular expression
-        vec_risk_factor_t get_risk_factors(const std::string &expr) const;
+        // after the warm-up pricing pass the market can be frozen: from then on it
+        // is immutable, any attempt to build a new object or modify the data points
+        // throws, and it can be shared by any number of threads
+        void freeze()
+        {
+            m_frozen = true;
+            m_curves.reclaim();
+        }
 
-        // clear all market curves execpt for the data points
-        void clear()
+        bool is_frozen() const
         {
-            std::for_each(m_curves.begin(), m_curves.end(), [](auto &p)
-                          { p.second.reset(); });
+            return m_frozen;
         }
 
-        // destroy all existing objects and modify a selected number of data points
+        // returns risk factors matching a regular expression (see RiskFactorSelector)
+        vec_risk_factor_t get_risk_factors(const std::string &expr) const
+        {
+            return get_risk_factors(RiskFactorSelector(expr));
+        }
+
+        // returns risk factors matching a precompiled selector
+        vec_risk_factor_t get_risk_factors(const RiskFactorSelector &sel) const;
+
+        // clear all market curves execpt for the data points
+        void clear();
+
+        // modify a selected number of data points and destroy the curves depending on them
         void set_risk_factors(const vec_risk_factor_t &risk_factors);
 
     private:
+        typedef ICurve *(*curve_factory_t)(Market *mkt, const Date &today, const string &name);
+
+        // placeholder for a lazily built curve
+        struct curve_slot
+        {
+            curve_slot(curve_factory_t factory) : m_factory(factory), m_ready(nullptr) {}
+            curve_slot(const curve_slot &other)
+                : m_factory(other.m_factory), m_curve(other.m_curve), m_deps(other.m_deps), m_ready(other.m_ready.load())
+            {
+            }
+
+            void reset()
+            {
+                m_ready.store(nullptr);
+                m_curve.reset();
+                m_deps.clear();
+            }
+
+            curve_factory_t m_factory;         // builds the curve, the type never changes
+            ptr_curve_t m_curve;               // owner of the curve
+            risk_factor_names_t m_deps;        // risk factors read while building the curve
+            std::atomic<const ICurve *> m_ready; // published once m_curve and m_deps are set
+            std::mutex m_build;                // serializes construction
+        };
+
         Date m_today;
         std::shared_ptr<const MarketDataServer> m_mds;
+        bool m_frozen;
+        std::atomic<size_t> m_layout_id;
+        mutable std::atomic<bool> m_shared_layout; // other markets may have the same layout id
 
         // market curves
-        std::map<string, ptr_curve_t> m_curves;
+        ConcurrentIndex<curve_slot> m_curves;
+
+        // raw risk factors: m_values[i] is the value of the symbol with id i,
+        // NaN if it has not been fetched yet. Copying a market copies one flat array.
+        psymbols_t m_symbols;
+        std::vector<double> m_values;
+        mutable std::mutex m_fetch; // serializes fetches from the market data server
 
-        // raw risk factors
-        std::map<string, double> m_risk_factors;
+        std::shared_ptr<DFCacheStats> m_df_stats; // null if discount factors are not cached
     };
 
 } // namespace minirisk
@@ -1,11 +1,42 @@
 #include "MarketDataServer.h"
+#include "MappedFile.h"
+#include "RiskFactorSelector.h"
 #include "Macros.h"
 #include "Streamer.h"
 
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
 #include <limits>
 
 namespace minirisk {
 
+namespace {
+
+// Binary snapshot (version 1). All values are in native byte order.
+//
+//  header    char magic[8] = "MRMDSNAP", uint32 byte order mark 0x01020304,
+//            uint32 version, uint64 number of data points n, uint64 size of names
+//  values    double[n], in name order
+//  names     uint64[n] offset of the end of each name, followed by the names
+//            concatenated, sorted and without separators. Snapshots whose names are
+//            not sorted or not unique are rejected.
+const char magic[8] = { 'M', 'R', 'M', 'D', 'S', 'N', 'A', 'P' };
+const uint32_t byte_order_mark = 0x01020304;
+const uint32_t snapshot_version = 1;
+
+struct header_t
+{
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t version;
+    uint64_t n;
+    uint64_t names_size;
+};
+
+} // anonymous namespace
+
 // transforms FX.SPOT.EUR.USD into FX.SPOT.EUR
 string mds_spot_name(const string& name)
 {
@@ -16,39 +47,144 @@ string mds_spot_name(const string& name)
 }
 
 MarketDataServer::MarketDataServer(const string& filename)
+{
+    if (is_snapshot(filename))
+        load_snapshot(filename);
+    else
+        load_text(filename);
+}
+
+MarketDataServer::~MarketDataServer()
+{
+}
+
+bool MarketDataServer::is_snapshot(const string& filename)
+{
+    std::ifstream is(filename, std::ios::binary);
+    char buf[sizeof(magic)];
+    return is.read(buf, sizeof(buf)) && std::memcmp(buf, magic, sizeof(magic)) == 0;
+}
+
+void MarketDataServer::load_text(const string& filename)
 {
     std::ifstream is(filename);
     MYASSERT(!is.fail(), "Could not open file " << filename);
-    do {
-        string name;
-        double value;
-        is >> name >> value;
-        //std::cout << name << " " << value << "\n";
-        auto ins = m_data.emplace(name, value);
-        MYASSERT(ins.second, "Duplicated risk factor: " << name);
-    } while (is);
+    std::vector<std::pair<string, double>> data;
+    string name;
+    double value;
+    while (is >> name >> value)
+        data.emplace_back(name, value);
+    std::sort(data.begin(), data.end());
+
+    // intern the names; as both are sorted, ids match the order of data
+    std::vector<string> names;
+    names.reserve(data.size());
+    m_values.reserve(data.size());
+    for (auto& d : data) {
+        names.push_back(std::move(d.first));
+        m_values.push_back(d.second);
+    }
+    m_symbols.reset(new SymbolTable(std::move(names)));
+    m_data = m_values;
+}
+
+void MarketDataServer::load_snapshot(const string& filename)
+{
+    m_file.reset(new MappedFile(filename));
+    const char* p = m_file->data();
+    const size_t size = m_file->size();
+    MYASSERT(size >= sizeof(header_t), "Not a market data snapshot: " << filename);
+    const header_t& h = *reinterpret_cast<const header_t*>(p);
+    MYASSERT(std::memcmp(h.magic, magic, sizeof(magic)) == 0, "Not a market data snapshot: " << filename);
+    MYASSERT(h.byte_order == byte_order_mark, "Market data snapshot with different byte order: " << filename);
+    MYASSERT(h.version == snapshot_version, "Unsupported market data snapshot version " << h.version << " in " << filename);
+    const size_t n = size_t(h.n);
+    // divide rather than multiply, so that a corrupted count cannot overflow
+    const size_t rest = size - sizeof(header_t);
+    MYASSERT(n <= rest / (sizeof(double) + sizeof(uint64_t)) && h.names_size == rest - n * (sizeof(double) + sizeof(uint64_t)),
+        "Truncated market data snapshot: " << filename);
+
+    const double* values = reinterpret_cast<const double*>(p + sizeof(header_t));
+    const uint64_t* name_end = reinterpret_cast<const uint64_t*>(values + n);
+    const char* names_data = reinterpret_cast<const char*>(name_end + n);
+
+    std::vector<std::string_view> names(n);
+    uint64_t begin = 0;
+    for (size_t i = 0; i < n; ++i) {
+        MYASSERT(begin <= name_end[i] && name_end[i] <= h.names_size, "Corrupted market data snapshot: " << filename);
+        names[i] = std::string_view(names_data + begin, name_end[i] - begin);
+        begin = name_end[i];
+    }
+    // the names refer to the mapped file, which the symbol table keeps alive
+    try {
+        m_symbols.reset(new SymbolTable(std::move(names), m_file));
+    }
+    catch (const std::exception& e) {
+        THROW("Corrupted market data snapshot " << filename << ": " << e.what());
+    }
+    m_data = std::span<const double>(values, n);
+}
+
+void MarketDataServer::save_snapshot(const string& filename) const
+{
+    const size_t n = m_symbols->size();
+    std::vector<uint64_t> name_end(n);
+    string names_data;
+    for (size_t i = 0; i < n; ++i) {
+        names_data += m_symbols->name(i);
+        name_end[i] = names_data.size();
+    }
+
+    header_t h{};
+    std::memcpy(h.magic, magic, sizeof(magic));
+    h.byte_order = byte_order_mark;
+    h.version = snapshot_version;
+    h.n = n;
+    h.names_size = names_data.size();
+
+    std::ofstream of(filename, std::ios::binary | std::ios::trunc);
+    MYASSERT(!of.fail(), "Could not open file " << filename);
+    of.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    of.write(reinterpret_cast<const char*>(m_data.data()), n * sizeof(double));
+    of.write(reinterpret_cast<const char*>(name_end.data()), n * sizeof(uint64_t));
+    of.write(names_data.data(), names_data.size());
+    MYASSERT(!of.fail(), "Could not write file " << filename);
+}
+
+void MarketDataServer::save(const string& filename) const
+{
+    std::ofstream of(filename);
+    MYASSERT(!of.fail(), "Could not open file " << filename);
+    for (size_t i = 0; i < m_symbols->size(); ++i) {
+        // shortest representation which reads back to the same value
+        char buf[32];
+        char* e = std::to_chars(buf, buf + sizeof(buf), m_data[i]).ptr;
+        of << m_symbols->name(i) << " " << string(buf, e) << "\n";
+    }
+    MYASSERT(!of.fail(), "Could not write file " << filename);
 }
 
 double MarketDataServer::get(const string& name) const
 {
-    auto iter = m_data.find(name);
-    MYASSERT(iter != m_data.end(), "Market data not found: " << name);
-    return iter->second;
+    size_t id = m_symbols->find(name);
+    MYASSERT(id != SymbolTable::npos, "Market data not found: " << name);
+    return m_data[id];
 }
 
 std::pair<double, bool> MarketDataServer::lookup(const string& name) const
 {
-    auto iter = m_data.find(name);
-    return (iter != m_data.end())  // found?
-            ? std::make_pair(iter->second, true)
+    size_t id = m_symbols->find(name);
+    return (id != SymbolTable::npos)  // found?
+            ? std::make_pair(m_data[id], true)
             : std::make_pair(std::numeric_limits<double>::quiet_NaN(), false);
 }
 
 std::vector<std::string> MarketDataServer::match(const std::string& expr) const
 {
-    std::regex r(expr);
-    NOT_IMPLEMENTED;
+    std::vector<std::string> res;
+    for (size_t id : RiskFactorSelector(expr).select(*m_symbols))
+        res.emplace_back(m_symbols->name(id));
+    return res;
 }
 
 } // namespace minirisk
-
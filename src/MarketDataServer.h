@@ -1,34 +1,59 @@
 #pragma once
 
-#include <map>
-#include <regex>
+#include <memory>
+#include <span>
 #include "Global.h"
+#include "SymbolTable.h"
 
 namespace minirisk {
 
+struct MappedFile;
+
 // This is a dummy object that in a real system should be replaced by a server providing
 // with real time (or historical) market data on demand and capable to produce snapshots of data.
 // For the purpose of this example this simply serves to clients some stale pre-loaded market info.
+//
+// Market data is loaded either from a text file with one "name value" pair per line,
+// or from a binary snapshot (see save_snapshot), which is memory mapped: values and
+// names are used in place.
 struct MarketDataServer
 {
 public:
     MarketDataServer(const string& filename);
+    ~MarketDataServer();
 
     // queries
     double get(const string& name) const;
     std::pair<double, bool> lookup(const string& name) const;
+
+    // names of the data points matching a regular expression, sorted (see RiskFactorSelector)
     std::vector<std::string> match(const std::string& expr) const;
 
-private:
-    // for simplicity, assumes market data can only have type double
-    std::map<string, double> m_data;
-};
+    // names of all the data points, m_data[i] is the value of symbol i
+    const psymbols_t& symbols() const { return m_symbols; }
+    double get(size_t id) const { return m_data[id]; }
 
-string mds_spot_name(const string& name);
+    // save all the data points in binary snapshot format
+    void save_snapshot(const string& filename) const;
 
-} // namespace minirisk
+    // save all the data points in text format
+    void save(const string& filename) const;
 
+    // true if the file starts with the magic string of the binary snapshot format
+    static bool is_snapshot(const string& filename);
 
+private:
+    void load_text(const string& filename);
+    void load_snapshot(const string& filename);
 
+private:
+    psymbols_t m_symbols;
+    // for simplicity, assumes market data can only have type double
+    std::span<const double> m_data;
+    std::vector<double> m_values;       // storage of m_data when loaded from text
+    std::shared_ptr<MappedFile> m_file; // storage of m_data and of the names when loaded from a snapshot
+};
 
+string mds_spot_name(const string& name);
 
+} // namespace minirisk
@@ -0,0 +1,268 @@
+#include "PortfolioColumns.h"
+#include "PortfolioUtils.h"
+#include "TradeTypes.h"
+#include "TradeBook.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace minirisk {
+
+namespace {
+
+const char magic[8] = { 'M', 'R', 'P', 'F', 'C', 'O', 'L', 'S' };
+const uint32_t byte_order_mark = 0x01020304;
+const size_t alignment = 64;
+
+enum : uint32_t { elem_u32 = 1, elem_f64 = 2, elem_char4 = 3 };
+
+struct header_t
+{
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t version;
+    uint64_t n_trades;
+    uint32_t n_columns;
+    uint32_t reserved;
+};
+
+struct column_t
+{
+    char name[16];
+    uint32_t elem_type;
+    uint32_t elem_size;
+    uint64_t offset;
+};
+
+size_t align(size_t n)
+{
+    return (n + alignment - 1) / alignment * alignment;
+}
+
+// element type of the column of a trade field of type F
+template <typename F>
+struct field_codec;
+
+template <>
+struct field_codec<string>
+{
+    static const uint32_t type = elem_char4;
+    static const uint32_t size = sizeof(PortfolioColumns::ccy_code_t);
+
+    static void read(const char* p, string& v)
+    {
+        v = PortfolioColumns::ccy_name(*reinterpret_cast<const PortfolioColumns::ccy_code_t*>(p));
+    }
+
+    static void write(char* p, const string& v)
+    {
+        MYASSERT(v.size() <= size, "String too long for the columnar format: " << v);
+        std::memcpy(p, v.data(), v.size());
+    }
+};
+
+template <>
+struct field_codec<double>
+{
+    static const uint32_t type = elem_f64;
+    static const uint32_t size = sizeof(double);
+    static void read(const char* p, double& v) { std::memcpy(&v, p, size); }
+    static void write(char* p, double v) { std::memcpy(p, &v, size); }
+};
+
+template <>
+struct field_codec<Date>
+{
+    static const uint32_t type = elem_u32;
+    static const uint32_t size = sizeof(uint32_t);
+
+    static void read(const char* p, Date& v)
+    {
+        uint32_t serial;
+        std::memcpy(&serial, p, size);
+        v = Date(serial);
+    }
+
+    static void write(char* p, const Date& v)
+    {
+        uint32_t serial = v.serial();
+        std::memcpy(p, &serial, size);
+    }
+};
+
+// the columns of the fields of trade type T, in the order of T::visit_columns
+template <typename T>
+std::vector<const PortfolioColumns::column_info_t*> field_columns(const PortfolioColumns& cols)
+{
+    std::vector<const PortfolioColumns::column_info_t*> res;
+    T t;
+    T::visit_columns(t, [&](const char* name, auto& field) {
+        typedef field_codec<std::decay_t<decltype(field)>> codec_t;
+        res.push_back(&cols.column(name, codec_t::type, codec_t::size));
+    });
+    return res;
+}
+
+// column being written
+struct column_data_t
+{
+    uint32_t type;
+    uint32_t size;
+    std::vector<char> data;
+};
+
+} // anonymous namespace
+
+bool PortfolioColumns::is_columnar(const string& filename)
+{
+    std::ifstream is(filename, std::ios::binary);
+    char buf[sizeof(magic)];
+    return is.read(buf, sizeof(buf)) && std::memcmp(buf, magic, sizeof(magic)) == 0;
+}
+
+string PortfolioColumns::ccy_name(const ccy_code_t& code)
+{
+    return string(code.data(), strnlen(code.data(), code.size()));
+}
+
+PortfolioColumns::PortfolioColumns(const string& filename)
+    : m_file(filename)
+{
+    MYASSERT(m_file.size() >= sizeof(header_t), "Not a columnar portfolio file: " << filename);
+    const header_t& h = *reinterpret_cast<const header_t*>(m_file.data());
+    MYASSERT(std::memcmp(h.magic, magic, sizeof(magic)) == 0, "Not a columnar portfolio file: " << filename);
+    MYASSERT(h.byte_order == byte_order_mark, "Columnar portfolio file with different byte order: " << filename);
+    MYASSERT(h.version == version, "Unsupported columnar portfolio version " << h.version << " in " << filename);
+    // the bounds checks divide rather than multiply, so that corrupted counts cannot overflow
+    MYASSERT(h.n_columns <= (m_file.size() - sizeof(header_t)) / sizeof(column_t), "Truncated columnar portfolio file: " << filename);
+    m_n_trades = size_t(h.n_trades);
+
+    const column_t* dir = reinterpret_cast<const column_t*>(m_file.data() + sizeof(header_t));
+    for (uint32_t i = 0; i < h.n_columns; ++i) {
+        const column_t& c = dir[i];
+        const string name(c.name, strnlen(c.name, sizeof(c.name)));
+        MYASSERT(c.elem_size > 0 && c.offset % c.elem_size == 0 && c.offset <= m_file.size()
+            && m_n_trades <= (m_file.size() - c.offset) / c.elem_size, "Column " << name << " is out of bounds");
+        m_columns[name] = column_info_t{ c.elem_type, c.elem_size, m_file.data() + c.offset };
+    }
+
+    m_type = column<guid_t>("type", elem_u32);
+    m_quantity = column<double>("quantity", elem_f64);
+    if (m_columns.count("ccy") && m_columns.count("delivery")) {
+        m_ccy = column<ccy_code_t>("ccy", elem_char4);
+        m_delivery = column<uint32_t>("delivery", elem_u32);
+    }
+}
+
+const PortfolioColumns::column_info_t& PortfolioColumns::column(const string& name, uint32_t elem_type, uint32_t elem_size) const
+{
+    auto i = m_columns.find(name);
+    MYASSERT(i != m_columns.end(), "Column " << name << " not found");
+    MYASSERT(i->second.elem_type == elem_type && i->second.elem_size == elem_size, "Column " << name << " has unexpected type");
+    return i->second;
+}
+
+template <typename T>
+std::span<const T> PortfolioColumns::column(const char* name, uint32_t elem_type) const
+{
+    return std::span<const T>(reinterpret_cast<const T*>(column(name, elem_type, sizeof(T)).data), m_n_trades);
+}
+
+portfolio_t PortfolioColumns::trades(size_t begin, size_t end) const
+{
+    MYASSERT(begin <= end && end <= size(), "Invalid trade range [" << begin << "," << end << ")");
+    auto book = std::make_shared<TradeBook>();
+
+    // columns of each trade type, looked up when its first trade is met
+    std::array<std::vector<const column_info_t*>, max_guid(trade_types_t()) + 1> fields;
+    for (size_t i = begin; i < end; ++i) {
+        bool found = visit_type(trade_types_t(), m_type[i], [&](auto* tag) {
+            typedef std::remove_pointer_t<decltype(tag)> T;
+            std::vector<const column_info_t*>& cols = fields[T::m_id];
+            if (cols.empty())
+                cols = field_columns<T>(*this);
+            T t;
+            static_cast<Trade<T>&>(t).init(m_quantity[i]);
+            size_t k = 0;
+            T::visit_columns(t, [&](const char*, auto& field) {
+                typedef field_codec<std::decay_t<decltype(field)>> codec_t;
+                codec_t::read(cols[k]->data + i * codec_t::size, field);
+                ++k;
+            });
+            book->add(t);
+        });
+        MYASSERT(found, "Unknown trade type:" << m_type[i]);
+    }
+    return book->portfolio();
+}
+
+void save_portfolio_columns(const string& filename, const portfolio_t& portfolio)
+{
+    const size_t n = portfolio.size();
+
+    // columns in order of first use, created zero filled
+    std::vector<std::pair<string, column_data_t>> columns;
+    auto get_column = [&](const char* name, uint32_t type, uint32_t size) -> char*
+    {
+        auto c = std::find_if(columns.begin(), columns.end(), [&](const auto& c) { return c.first == name; });
+        if (c == columns.end()) {
+            columns.emplace_back(name, column_data_t{ type, size, std::vector<char>(n * size) });
+            c = columns.end() - 1;
+        }
+        MYASSERT(c->second.type == type && c->second.size == size, "Column " << name << " is used by fields of different types");
+        return c->second.data.data();
+    };
+    char* type = get_column("type", elem_u32, sizeof(guid_t));
+    char* quantity = get_column("quantity", elem_f64, sizeof(double));
+
+    for (size_t i = 0; i < n; ++i) {
+        const ITrade& trade = *portfolio[i];
+        const guid_t id = trade.id();
+        std::memcpy(type + i * sizeof(guid_t), &id, sizeof(guid_t));
+        field_codec<double>::write(quantity + i * sizeof(double), trade.quantity());
+        bool found = visit_type(trade_types_t(), id, [&](auto* tag) {
+            typedef std::remove_pointer_t<decltype(tag)> T;
+            T::visit_columns(static_cast<const T&>(trade), [&](const char* name, const auto& field) {
+                typedef field_codec<std::decay_t<decltype(field)>> codec_t;
+                codec_t::write(get_column(name, codec_t::type, codec_t::size) + i * codec_t::size, field);
+            });
+        });
+        MYASSERT(found, "Trade type " << trade.idname() << " cannot be saved in columnar format");
+    }
+    const uint32_t n_columns = uint32_t(columns.size());
+
+    header_t h{};
+    std::memcpy(h.magic, magic, sizeof(magic));
+    h.byte_order = byte_order_mark;
+    h.version = PortfolioColumns::version;
+    h.n_trades = n;
+    h.n_columns = n_columns;
+
+    std::vector<column_t> dir(n_columns);
+    size_t offset = align(sizeof(header_t) + n_columns * sizeof(column_t));
+    for (uint32_t i = 0; i < n_columns; ++i) {
+        dir[i] = column_t{};
+        MYASSERT(columns[i].first.size() <= sizeof(dir[i].name), "Column name too long: " << columns[i].first);
+        std::strncpy(dir[i].name, columns[i].first.c_str(), sizeof(dir[i].name));
+        dir[i].elem_type = columns[i].second.type;
+        dir[i].elem_size = columns[i].second.size;
+        dir[i].offset = offset;
+        offset = align(offset + n * columns[i].second.size);
+    }
+
+    std::ofstream of(filename, std::ios::binary | std::ios::trunc);
+    MYASSERT(!of.fail(), "Could not open file " << filename);
+    of.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    of.write(reinterpret_cast<const char*>(dir.data()), dir.size() * sizeof(column_t));
+    const char zeros[alignment] = {};
+    size_t pos = sizeof(header_t) + n_columns * sizeof(column_t);
+    for (uint32_t i = 0; i < n_columns; ++i) {
+        of.write(zeros, dir[i].offset - pos);
+        of.write(columns[i].second.data.data(), n * columns[i].second.size);
+        pos = dir[i].offset + n * columns[i].second.size;
+    }
+    MYASSERT(!of.fail(), "Could not write file " << filename);
+}
+
+} // namespace minirisk
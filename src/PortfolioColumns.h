@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <span>
+
+#include "ITrade.h"
+#include "MappedFile.h"
+
+namespace minirisk {
+
+// Binary columnar portfolio file (version 1). All values are in native byte order.
+//
+//  header     char magic[8] = "MRPFCOLS", uint32 byte order mark 0x01020304,
+//             uint32 version, uint64 number of trades, uint32 number of columns,
+//             uint32 reserved
+//  directory  for each column: char name[16], uint32 element type, uint32 element size,
+//             uint64 offset from the beginning of the file
+//  data       one array per column with one element per trade, 64 byte aligned
+//
+// Columns:
+//  "type"      uint32   trade type id (guid_t)
+//  "quantity"  double   trade quantity
+// followed by the columns of the fields of each trade type present in the file, as
+// listed by T::visit_columns (see TradeTypes.h). Strings are stored as char[4] zero
+// padded (currency codes), doubles as double and dates as uint32 Date::serial, e.g.
+//  "ccy"       char[4]  currency (Payment)
+//  "delivery"  uint32   delivery date (Payment)
+// Types sharing a column name share the column; rows of other types are zero.
+//
+// Readers look columns up by name, so columns can be added without breaking them.
+struct PortfolioColumns
+{
+    typedef std::array<char, 4> ccy_code_t;
+
+    static const uint32_t version = 1;
+
+    // map the file and validate its layout
+    PortfolioColumns(const string& filename);
+
+    // true if the file starts with the magic string of this format
+    static bool is_columnar(const string& filename);
+
+    size_t size() const { return m_n_trades; }
+
+    std::span<const guid_t> type() const { return m_type; }
+    std::span<const double> quantity() const { return m_quantity; }
+    // Payment columns, empty if the file has no payments
+    std::span<const ccy_code_t> ccy() const { return m_ccy; }
+    std::span<const uint32_t> delivery() const { return m_delivery; }
+
+    static string ccy_name(const ccy_code_t& code);
+
+    // build the trade objects
+    portfolio_t trades() const { return trades(0, size()); }
+
+    // build the trade objects with index in [begin,end)
+    portfolio_t trades(size_t begin, size_t end) const;
+
+    // a column in the file
+    struct column_info_t
+    {
+        uint32_t elem_type;
+        uint32_t elem_size;
+        const char* data;
+    };
+
+    // the column with the given name, which must have the given element type and size
+    const column_info_t& column(const string& name, uint32_t elem_type, uint32_t elem_size) const;
+
+private:
+    template <typename T>
+    std::span<const T> column(const char* name, uint32_t elem_type) const;
+
+private:
+    MappedFile m_file;
+    size_t m_n_trades;
+    std::map<string, column_info_t> m_columns;
+    std::span<const guid_t> m_type;
+    std::span<const double> m_quantity;
+    std::span<const ccy_code_t> m_ccy;
+    std::span<const uint32_t> m_delivery;
+};
+
+} // namespace minirisk
@@ -0,0 +1,123 @@
+#include "PortfolioGenerator.h"
+#include "CounterRNG.h"
+#include "TradeBook.h"
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace minirisk {
+
+namespace {
+
+// tenors of the generated pillar curves, in days as in CurveDiscount
+const std::pair<const char*, unsigned> tenors[] = {
+    { "1W", 7 }, { "2W", 14 }, { "1M", 30 }, { "2M", 60 }, { "3M", 90 },
+    { "6M", 180 }, { "1Y", 365 }, { "2Y", 730 }, { "5Y", 1825 }, { "10Y", 3650 }
+};
+
+// streams of random numbers, so that adding a field does not change the others
+enum : uint32_t { draw_type, draw_ccy1, draw_ccy2, draw_quantity, draw_date1, draw_date2, draw_strike, draw_rate, draw_spot };
+
+uint32_t ccy_key(const string& ccy)
+{
+    uint32_t k = 0;
+    for (char c : ccy)
+        k = k * 256 + (unsigned char)c;
+    return k;
+}
+
+// value in USD of one unit of ccy, a function of the currency and the seed only
+double fx_spot(const CounterRNG& rng, const string& ccy)
+{
+    if (ccy == "USD")
+        return 1.0;
+    return std::exp(4.0 * rng.uniform({ { ccy_key(ccy), draw_spot, 0, 0 } }) - 3.0);
+}
+
+// yield rate of ccy at the k-th pillar (or the flat rate), increasing with the tenor
+double ir_rate(const CounterRNG& rng, const string& ccy, size_t k)
+{
+    double r = 0.005 + 0.06 * rng.uniform({ { ccy_key(ccy), draw_rate, 0, 0 } });
+    return r + 0.002 * k;
+}
+
+} // anonymous namespace
+
+std::vector<std::pair<string, double>> parse_ccy_mix(const string& mix)
+{
+    std::vector<std::pair<string, double>> res;
+    std::istringstream is(mix);
+    string item;
+    while (std::getline(is, item, ',')) {
+        size_t colon = item.find(':');
+        double w = colon == string::npos ? 1.0 : std::stod(item.substr(colon + 1));
+        MYASSERT(w > 0.0, "Invalid currency weight in " << item);
+        res.emplace_back(item.substr(0, colon), w);
+    }
+    MYASSERT(!res.empty(), "Empty currency mix");
+    return res;
+}
+
+portfolio_t generate_portfolio(const generator_settings_t& settings, const Date& today)
+{
+    MYASSERT(!settings.ccy_mix.empty(), "Empty currency mix");
+    MYASSERT(settings.max_days >= 2, "The date spread must be at least 2 days");
+    MYASSERT(!settings.pillars || settings.max_days <= tenors[std::size(tenors) - 1].second, "Dates beyond the last pillar cannot be priced");
+
+    const CounterRNG rng(settings.seed);
+    double total_weight = 0.0;
+    for (const auto& c : settings.ccy_mix)
+        total_weight += c.second;
+    auto pick_ccy = [&](double u) -> const string&
+    {
+        double w = u * total_weight;
+        for (const auto& c : settings.ccy_mix)
+            if ((w -= c.second) < 0.0)
+                return c.first;
+        return settings.ccy_mix.back().first;
+    };
+
+    auto book = std::make_shared<TradeBook>();
+    TradePayment pmt;
+    TradeFXForward fwd;
+    for (size_t i = 0; i < settings.n_trades; ++i) {
+        auto u = [&](uint32_t field) { return rng.uniform({ { uint32_t(i), uint32_t(i >> 32), field, 0 } }); };
+        const double quantity = std::round(2000.0 * u(draw_quantity) - 1000.0);
+        const string& ccy1 = pick_ccy(u(draw_ccy1));
+        const string& ccy2 = pick_ccy(u(draw_ccy2));
+        if (u(draw_type) < settings.fx_forward_share && ccy1 != ccy2) {
+            // fixing up to 30 days before settlement, the strike near the spot rate
+            const unsigned settle = 2 + unsigned(u(draw_date1) * (settings.max_days - 1));
+            const unsigned fixing = settle - std::min(settle - 1, 1 + unsigned(u(draw_date2) * 30));
+            const double strike = fx_spot(rng, ccy1) / fx_spot(rng, ccy2) * (0.9 + 0.2 * u(draw_strike));
+            fwd.init(ccy1, ccy2, quantity, strike, Date(today.serial() + fixing), Date(today.serial() + settle));
+            book->add(fwd);
+        }
+        else {
+            pmt.init(ccy1, quantity, Date(today.serial() + 1 + unsigned(u(draw_date1) * settings.max_days)));
+            book->add(pmt);
+        }
+    }
+    return book->portfolio();
+}
+
+void generate_risk_factors(const string& filename, const generator_settings_t& settings)
+{
+    const CounterRNG rng(settings.seed);
+    std::ofstream os(filename);
+    MYASSERT(!os.fail(), "Could not open file " << filename);
+    os.precision(17);
+    for (const auto& c : settings.ccy_mix) {
+        if (settings.pillars) {
+            for (size_t k = 0; k < std::size(tenors); ++k)
+                os << ir_rate_prefix << tenors[k].first << "." << c.first << " " << ir_rate(rng, c.first, k) << "\n";
+        }
+        else
+            os << ir_rate_prefix << c.first << " " << ir_rate(rng, c.first, 0) << "\n";
+        if (c.first != "USD")
+            os << fx_spot_prefix << c.first << " " << fx_spot(rng, c.first) << "\n";
+    }
+}
+
+} // namespace minirisk
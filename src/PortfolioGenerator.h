@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "Date.h"
+#include "ITrade.h"
+
+namespace minirisk {
+
+// Settings of a synthetic portfolio, and of the market data needed to price it.
+// The same settings and seed always generate the same files.
+struct generator_settings_t
+{
+    size_t n_trades = 1000;
+    uint64_t seed = 1;
+    std::vector<std::pair<string, double>> ccy_mix = { { "USD", 4 }, { "EUR", 3 }, { "GBP", 2 }, { "JPY", 1 } }; // currencies and relative weights
+    unsigned max_days = 3650;       // trade dates are spread uniformly over (today, today + max_days]
+    double fx_forward_share = 0.0;  // fraction of FX forwards, all other trades are payments
+    bool pillars = false;           // tenor pillar curves IR.<tenor>.<ccy> rather than flat rates IR.<ccy>
+};
+
+// parse a currency mix like "USD:4,EUR:3,JPY:1"
+std::vector<std::pair<string, double>> parse_ccy_mix(const string& mix);
+
+// random portfolio of payments and FX forwards in the currencies of the mix
+portfolio_t generate_portfolio(const generator_settings_t& settings, const Date& today);
+
+// save the risk factors needed to price the generated portfolios in market data server text format
+void generate_risk_factors(const string& filename, const generator_settings_t& settings);
+
+} // namespace minirisk
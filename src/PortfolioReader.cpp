@@ -0,0 +1,45 @@
+#include "PortfolioReader.h"
+#include "PortfolioColumns.h"
+#include "PortfolioUtils.h"
+#include "TradeBook.h"
+#include "Profiler.h"
+
+#include <algorithm>
+
+namespace minirisk {
+
+PortfolioReader::PortfolioReader(const string& filename)
+    : m_position(0)
+{
+    if (PortfolioColumns::is_columnar(filename))
+        m_columns.reset(new PortfolioColumns(filename));
+    else
+        m_text.reset(new my_ifstream(filename));
+}
+
+PortfolioReader::~PortfolioReader()
+{
+}
+
+bool PortfolioReader::next(size_t n, portfolio_t& trades)
+{
+    MYASSERT(n > 0, "Chunk size must be positive");
+    trades.clear();
+    if (m_columns) {
+        size_t end = std::min(m_columns->size(), m_position + n);
+        trades = m_columns->trades(m_position, end);
+    }
+    else if (m_text) {
+        PROFILE_SCOPE("portfolio.parse");
+        auto book = std::make_shared<TradeBook>();
+        while (book->size() < n && m_text->read_line())
+            book->load_trade(*m_text);
+        trades = book->portfolio();
+        if (trades.size() < n)
+            m_text.reset(); // end of file or empty line: the portfolio is over
+    }
+    m_position += trades.size();
+    return !trades.empty();
+}
+
+} // namespace minirisk
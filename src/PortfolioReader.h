@@ -0,0 +1,33 @@
+#pragma once
+
+#include <memory>
+
+#include "ITrade.h"
+
+namespace minirisk {
+
+struct PortfolioColumns;
+
+// Reads a portfolio file sequentially, a bounded number of trades at a time, so
+// that portfolios larger than memory can be processed in chunks.
+// Both the text and the binary columnar formats are supported. Text files are
+// read through a fixed size buffer, columnar files are memory mapped.
+struct PortfolioReader
+{
+    PortfolioReader(const string& filename);
+    ~PortfolioReader();
+
+    // replace the content of trades with the next (at most) n trades of the file.
+    // Returns false if there are no more trades.
+    bool next(size_t n, portfolio_t& trades);
+
+    // index in the file of the first trade returned by the next call to next()
+    size_t position() const { return m_position; }
+
+private:
+    std::unique_ptr<my_ifstream> m_text;
+    std::unique_ptr<PortfolioColumns> m_columns;
+    size_t m_position;
+};
+
+} // namespace minirisk
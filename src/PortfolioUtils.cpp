@@ -1,8 +1,19 @@
 #include "Global.h"
 #include "PortfolioUtils.h"
-#include "TradePayment.h"
+#include "TradeTypes.h"
+#include "ThreadPool.h"
+#include "PortfolioColumns.h"
+#include "MappedFile.h"
+#include "RiskSweep.h"
+#include "TradeBook.h"
+#include "Profiler.h"
 
+#include <cstring>
+#include <exception>
+#include <iterator>
+#include <map>
 #include <numeric>
+#include <set>
 
 namespace minirisk
 {
@@ -15,17 +26,40 @@ namespace minirisk
 
     std::vector<ppricer_t> get_pricers(const portfolio_t &portfolio)
     {
-        std::vector<ppricer_t> pricers(portfolio.size());
-        std::transform(portfolio.begin(), portfolio.end(), pricers.begin(), [](auto &pt) -> ppricer_t
-                       { return pt->pricer(); });
-        return pricers;
+        // pricers are placed contiguously in one book, rather than allocated one by one
+        return PricerBook::create(portfolio)->pricers();
     }
 
-    portfolio_values_t compute_prices(const std::vector<ppricer_t> &pricers, Market &mkt)
+    void bind_pricers(const std::vector<ppricer_t> &pricers, Market &mkt)
+    {
+        for (const auto &pp : pricers)
+            pp->bind(mkt);
+    }
+
+    portfolio_values_t compute_prices(const std::vector<ppricer_t> &pricers, Market &mkt, ThreadPool *pool, portfolio_dependencies_t *deps)
     {
         portfolio_values_t prices(pricers.size());
-        std::transform(pricers.begin(), pricers.end(), prices.begin(), [&mkt](auto &pp) -> double
-                       { return pp->price(mkt); });
+        if (deps)
+            deps->assign(pricers.size(), Market::risk_factor_names_t());
+
+        auto price_range = [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                if (deps)
+                {
+                    Market::dependency_recorder rec((*deps)[i]);
+                    prices[i] = pricers[i]->price(mkt);
+                }
+                else
+                    prices[i] = pricers[i]->price(mkt);
+            }
+        };
+
+        if (pool_size(pool) == 1)
+            price_range(0, pricers.size());
+        else
+            pool->parallel_for(pricers.size(), pool->default_chunk(pricers.size()), price_range);
         return prices;
     }
 
@@ -34,68 +68,193 @@ namespace minirisk
         return std::accumulate(values.begin(), values.end(), 0.0);
     }
 
-    std::vector<std::pair<string, portfolio_values_t>> compute_pv01(const std::vector<ppricer_t> &pricers, const Market &mkt)
+    fd_risk_t compute_risk(const std::vector<ppricer_t> &pricers, const Market &mkt, unsigned measures, ThreadPool *pool, const portfolio_dependencies_t *deps, const portfolio_values_t *base)
     {
-        std::vector<std::pair<string, portfolio_values_t>> pv01; // PV01 per trade
+        const double ir_bump = 0.01 / 100; // absolute
+        const double fx_bump = 0.01 / 100; // relative to the spot
 
-        const double bump_size = 0.01 / 100;
+        // PV01 and gamma are reported for every rate, flat or tenor pillar
+        static const RiskFactorSelector ir_rates(ir_rate_prefix + ".+");
+        static const RiskFactorSelector fx_spots(fx_spot_prefix + ".+");
+        const auto pv01_rf = measures & risk_pv01 ? mkt.get_risk_factors(ir_rates) : Market::vec_risk_factor_t();
+        const auto gamma_rf = measures & risk_gamma ? mkt.get_risk_factors(ir_rates) : Market::vec_risk_factor_t();
+        const auto fx_rf = measures & (risk_fx_delta | risk_gamma) ? mkt.get_risk_factors(fx_spots) : Market::vec_risk_factor_t();
+
+        RiskSweep sweep(pricers, mkt, pool, deps, base);
+
+        // Register all the states first, so that the trades are walked once.
+        // The down and up states of a rate are shared by its PV01 and gamma.
+        typedef std::pair<size_t, size_t> dn_up_t;
+        auto central = [&](const Market::risk_factor_t &rf, double h) -> dn_up_t
+        {
+            return dn_up_t(sweep.add_bump(rf, -h), sweep.add_bump(rf, h));
+        };
+        std::vector<dn_up_t> pv01_states, gamma_states, fx_states;
+        for (const auto &rf : pv01_rf)
+            pv01_states.push_back(central(rf, ir_bump));
+        for (const auto &rf : gamma_rf)
+            gamma_states.push_back(central(rf, ir_bump));
+        if (measures & risk_fx_delta)
+            for (const auto &rf : fx_rf)
+                fx_states.push_back(central(rf, rf.second * fx_bump));
+
+        // Cross gammas, for each pair of a rate and a spot read together by some trade:
+        // the central difference in the spot of the central difference in the rate, from
+        // the four states with both risk factors bumped down and up (the error is O(h^2),
+        // as for the other measures).
+        struct cross_t
+        {
+            size_t ir, fx;
+            dn_up_t fx_dn, fx_up; // rate bumped down and up, with the spot bumped down / up
+        };
+        std::set<std::pair<size_t, size_t>> pairs;
+        if (!gamma_rf.empty() && !fx_rf.empty())
+        {
+            // one pass over the risk factors read by each trade
+            std::map<string, size_t> ir_index, fx_index;
+            for (size_t i = 0; i < gamma_rf.size(); ++i)
+                ir_index.emplace(gamma_rf[i].first, i);
+            for (size_t f = 0; f < fx_rf.size(); ++f)
+                fx_index.emplace(fx_rf[f].first, f);
+            std::vector<size_t> irs, fxs;
+            for (const auto &d : sweep.dependencies())
+            {
+                irs.clear();
+                fxs.clear();
+                for (const string &name : d)
+                {
+                    auto i = ir_index.find(name);
+                    if (i != ir_index.end())
+                        irs.push_back(i->second);
+                    auto f = fx_index.find(name);
+                    if (f != fx_index.end())
+                        fxs.push_back(f->second);
+                }
+                for (size_t i : irs)
+                    for (size_t f : fxs)
+                        pairs.emplace(i, f);
+            }
+        }
+        std::vector<cross_t> cross;
+        for (const auto &p : pairs)
+        {
+            auto state = [&](double ir_shift, double fx_factor)
+            {
+                Market::vec_risk_factor_t v{gamma_rf[p.first], fx_rf[p.second]};
+                v[0].second += ir_shift;
+                v[1].second *= fx_factor;
+                return sweep.add_state(v);
+            };
+            cross.push_back(cross_t{p.first, p.second,
+                                    dn_up_t(state(-ir_bump, 1.0 - fx_bump), state(ir_bump, 1.0 - fx_bump)),
+                                    dn_up_t(state(-ir_bump, 1.0 + fx_bump), state(ir_bump, 1.0 + fx_bump))});
+        }
 
-        // filter risk factors related to IR
-        auto base = mkt.get_risk_factors(ir_rate_prefix + "[A-Z]{3}");
+        sweep.run();
 
-        // Make a local copy of the Market object, because we will modify it applying bumps
-        // Note that the actual market objects are shared, as they are referred to via pointers
-        Market tmpmkt(mkt);
+        // finite difference estimators
+        fd_risk_t res;
+        auto first_order = [&](const Market::vec_risk_factor_t &rf, const std::vector<dn_up_t> &states, double h, bool relative, std::vector<std::pair<string, portfolio_values_t>> &out)
+        {
+            for (size_t i = 0; i < rf.size(); ++i)
+            {
+                const portfolio_values_t &pv_dn = sweep.prices(states[i].first);
+                const portfolio_values_t &pv_up = sweep.prices(states[i].second);
+                const double dx = 2.0 * (relative ? rf[i].second * h : h);
+                out.push_back(std::make_pair(rf[i].first, std::vector<double>(pricers.size())));
+                std::transform(pv_up.begin(), pv_up.end(), pv_dn.begin(), out.back().second.begin(), [dx](double hi, double lo) -> double
+                               { return (hi - lo) / dx; });
+            }
+        };
+        first_order(pv01_rf, pv01_states, ir_bump, false, res.pv01);
+        first_order(fx_rf, fx_states, fx_bump, true, res.fx_delta);
 
-        // compute prices for perturbated markets and aggregate results
-        pv01.reserve(base.size());
-        for (const auto &d : base)
+        const portfolio_values_t &pv = sweep.base();
+        for (size_t i = 0; i < gamma_rf.size(); ++i)
         {
-            std::vector<double> pv_up, pv_dn;
-            std::vector<std::pair<string, double>> bumped(1, d);
-            pv01.push_back(std::make_pair(d.first, std::vector<double>(pricers.size())));
-
-            // bump down and price
-            bumped[0].second = d.second - bump_size;
-            tmpmkt.set_risk_factors(bumped);
-            pv_dn = compute_prices(pricers, tmpmkt);
-
-            // bump up and price
-            bumped[0].second = d.second + bump_size; // bump up
-            tmpmkt.set_risk_factors(bumped);
-            pv_up = compute_prices(pricers, tmpmkt);
-
-            // restore original market state for next iteration
-            // (more efficient than creating a new copy of the market at every iteration)
-            bumped[0].second = d.second;
-            tmpmkt.set_risk_factors(bumped);
-
-            // compute estimator of the derivative via central finite differences
-            double dr = 2.0 * bump_size;
-            std::transform(pv_up.begin(), pv_up.end(), pv_dn.begin(), pv01.back().second.begin(), [dr](double hi, double lo) -> double
-                           { return (hi - lo) / dr; });
+            const portfolio_values_t &pv_dn = sweep.prices(gamma_states[i].first);
+            const portfolio_values_t &pv_up = sweep.prices(gamma_states[i].second);
+            res.gamma.emplace_back(gamma_rf[i].first, portfolio_values_t(pricers.size()));
+            for (size_t t = 0; t < pricers.size(); ++t)
+                res.gamma.back().second[t] = (pv_up[t] - 2.0 * pv[t] + pv_dn[t]) / (ir_bump * ir_bump);
         }
+        for (const auto &c : cross)
+        {
+            const portfolio_values_t &dn_dn = sweep.prices(c.fx_dn.first);
+            const portfolio_values_t &up_dn = sweep.prices(c.fx_dn.second);
+            const portfolio_values_t &dn_up = sweep.prices(c.fx_up.first);
+            const portfolio_values_t &up_up = sweep.prices(c.fx_up.second);
+            const double ds = fx_rf[c.fx].second * fx_bump;
+            res.cross_gamma.emplace_back(gamma_rf[c.ir].first + " " + fx_rf[c.fx].first, portfolio_values_t(pricers.size()));
+            for (size_t t = 0; t < pricers.size(); ++t)
+                res.cross_gamma.back().second[t] = ((up_up[t] - dn_up[t]) - (up_dn[t] - dn_dn[t])) / (4.0 * ir_bump * ds);
+        }
+        return res;
+    }
+
+    std::vector<std::pair<string, portfolio_values_t>> compute_pv01(const std::vector<ppricer_t> &pricers, const Market &mkt, ThreadPool *pool, const portfolio_dependencies_t *deps)
+    {
+        return compute_risk(pricers, mkt, risk_pv01, pool, deps).pv01;
+    }
+
+    std::vector<std::pair<string, portfolio_values_t>> compute_sensitivities_aad(const std::vector<ppricer_t> &pricers, Market &mkt, ThreadPool *pool)
+    {
+        // gradient of each trade
+        std::vector<Market::vec_risk_factor_t> grads(pricers.size());
+
+        auto differentiate = [&](size_t begin, size_t end)
+        {
+            Tape tape; // one tape per chunk, reused across trades
+            for (size_t i = begin; i < end; ++i)
+            {
+                tape.clear();
+                ADouble pv = pricers[i]->price(mkt, tape);
+                tape.backward(pv);
+                grads[i] = tape.gradient();
+            }
+        };
+
+        if (pool_size(pool) == 1)
+            differentiate(0, pricers.size());
+        else
+            pool->parallel_for(pricers.size(), pool->default_chunk(pricers.size()), differentiate);
+
+        // scatter the gradients into one vector per risk factor
+        std::map<string, portfolio_values_t> sens;
+        for (size_t i = 0; i < grads.size(); ++i)
+            for (const auto &g : grads[i])
+            {
+                auto ins = sens.emplace(g.first, portfolio_values_t());
+                if (ins.second)
+                    ins.first->second.resize(pricers.size(), 0.0);
+                ins.first->second[i] += g.second;
+            }
 
-        return pv01;
+        return std::vector<std::pair<string, portfolio_values_t>>(sens.begin(), sens.end());
     }
 
+    template <typename T>
+    struct trade_loader
+    {
+        static ptrade_t call(my_ifstream &is)
+        {
+            ptrade_t p(new T);
+            p->load(is);
+            return p;
+        }
+    };
+
     ptrade_t load_trade(my_ifstream &is)
     {
-        string name;
-        ptrade_t p;
+        typedef ptrade_t (*loader_t)(my_ifstream &);
+        static constexpr auto loaders = make_dispatch_table<loader_t, trade_loader>(trade_types_t());
 
         // read trade identifier
         guid_t id;
         is >> id;
 
-        if (id == TradePayment::m_id)
-            p.reset(new TradePayment);
-        else
-            THROW("Unknown trade type:" << id);
-
-        p->load(is);
-
-        return p;
+        MYASSERT(id < loaders.size() && loaders[id], "Unknown trade type:" << id);
+        return loaders[id](is);
     }
 
     void save_portfolio(const string &filename, const std::vector<ptrade_t> &portfolio)
@@ -110,14 +269,85 @@ namespace minirisk
         of.close();
     }
 
-    std::vector<ptrade_t> load_portfolio(const string &filename)
+    // load the trades in [begin,end) of a text portfolio.
+    // Returns false if the range contains an empty line, which terminates the portfolio.
+    static bool load_trades(const char *begin, const char *end, TradeBook &book)
+    {
+        PROFILE_SCOPE("portfolio.parse");
+        my_ifstream is(begin, end);
+        while (is.read_line())
+            book.load_trade(is);
+        return is.eof();
+    }
+
+    std::vector<ptrade_t> load_portfolio(const string &filename, ThreadPool *pool)
     {
+        PROFILE_SCOPE("portfolio.load");
+        if (PortfolioColumns::is_columnar(filename))
+            return PortfolioColumns(filename).trades();
+
         std::vector<ptrade_t> portfolio;
 
-        // test reloading the portfolio
-        my_ifstream is(filename);
-        while (is.read_line())
-            portfolio.push_back(load_trade(is));
+        if (pool_size(pool) == 1)
+        {
+            auto book = std::make_shared<TradeBook>();
+            my_ifstream is(filename);
+            PROFILE_SCOPE("portfolio.parse");
+            while (is.read_line())
+                book->load_trade(is);
+            return book->portfolio();
+        }
+
+        // split the file in ranges starting at the beginning of a line, a few per thread
+        MappedFile file(filename);
+        const char *data = file.data();
+        const char *end = data + file.size();
+        const size_t min_chunk_bytes = size_t(1) << 20;
+        const size_t n_chunks = std::max<size_t>(1, std::min(4 * pool->size(), file.size() / min_chunk_bytes));
+        std::vector<const char *> bounds(1, data);
+        for (size_t k = 1; k < n_chunks; ++k)
+        {
+            const char *p = std::max(data + k * file.size() / n_chunks, bounds.back());
+            const char *nl = static_cast<const char *>(std::memchr(p, '\n', end - p));
+            bounds.push_back(nl ? nl + 1 : end);
+        }
+        bounds.push_back(end);
+
+        // parse each range into its own book. Errors are kept per range, so that
+        // anything after an empty line is ignored as in a sequential read.
+        std::vector<std::shared_ptr<TradeBook>> chunks(n_chunks);
+        for (auto &c : chunks)
+            c = std::make_shared<TradeBook>();
+        std::vector<char> complete(n_chunks, 0);
+        std::vector<std::exception_ptr> errors(n_chunks);
+        pool->parallel_for(n_chunks, 1, [&](size_t b, size_t e)
+                           {
+            for (size_t k = b; k < e; ++k)
+            {
+                try
+                {
+                    complete[k] = load_trades(bounds[k], bounds[k + 1], *chunks[k]);
+                }
+                catch (...)
+                {
+                    errors[k] = std::current_exception();
+                }
+            } });
+
+        // reassemble in file order
+        size_t n_trades = 0;
+        for (const auto &c : chunks)
+            n_trades += c->size();
+        portfolio.reserve(n_trades);
+        for (size_t k = 0; k < n_chunks; ++k)
+        {
+            if (errors[k])
+                std::rethrow_exception(errors[k]);
+            portfolio_t trades(chunks[k]->portfolio());
+            std::move(trades.begin(), trades.end(), std::back_inserter(portfolio));
+            if (!complete[k])
+                break;
+        }
 
         return portfolio;
     }
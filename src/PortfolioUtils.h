@@ -8,27 +8,78 @@
 namespace minirisk {
 
 struct Market;
+struct ThreadPool;
 
 typedef std::vector<double> portfolio_values_t;
 
+// risk factors read by each trade
+typedef std::vector<Market::risk_factor_names_t> portfolio_dependencies_t;
+
 // get pricer for each trade
 std::vector<ppricer_t> get_pricers(const portfolio_t& portfolio);
 
+// resolve the market objects used by each pricer to handles valid for mkt and its copies
+void bind_pricers(const std::vector<ppricer_t>& pricers, Market& mkt);
+
 // compute prices
-portfolio_values_t compute_prices(const std::vector<ppricer_t>& pricers, Market& mkt);
+// If a pool is given, the pricers are split in chunks which are priced concurrently.
+// Each price is written to its own slot, so the result is identical to the serial one.
+// If deps is given, it is filled with the risk factors each trade depends on.
+portfolio_values_t compute_prices(const std::vector<ppricer_t>& pricers, Market& mkt, ThreadPool* pool = nullptr, portfolio_dependencies_t* deps = nullptr);
 
 // compute the cumulative book value
 double portfolio_total(const portfolio_values_t& values);
 
-// Compute PV01 (i.e. sensitivity with respect to interest rate dV/dr)
-// Use central differences, absolute bump of 0.01%, rescale result for rate movement of 0.01%
-std::vector<std::pair<string, portfolio_values_t>> compute_pv01(const std::vector<ppricer_t>& pricers, const Market& mkt);
+// finite difference sensitivities of each trade
+struct fd_risk_t
+{
+    std::vector<std::pair<string, portfolio_values_t>> pv01;        // dV/dr, by IR rate (flat or tenor pillar)
+    std::vector<std::pair<string, portfolio_values_t>> fx_delta;    // dV/dS, by FX spot
+    std::vector<std::pair<string, portfolio_values_t>> gamma;       // d2V/dr2, by IR rate (flat or tenor pillar)
+    std::vector<std::pair<string, portfolio_values_t>> cross_gamma; // d2V/drdS, by pair of IR rate and FX spot
+};
+
+// measures computed by compute_risk, can be combined
+enum : unsigned
+{
+    risk_pv01 = 1,
+    risk_fx_delta = 2,
+    risk_gamma = 4 // gamma ladder and IR x FX cross gamma
+};
+
+// Compute the requested sensitivities by finite differences, with central differences and an
+// absolute bump of 0.01% for rates, a relative bump of 0.01% for FX spots.
+// All the bumped market states are priced in a single pass over the trades (see RiskSweep),
+// and each state is priced once even if several measures use it: the down and up states
+// of a rate give both its PV01 and its gamma, and the cross gamma of a rate and a spot read
+// together by some trade adds the four states with both bumped down and up.
+// Only the trades reading a bumped risk factor are repriced. Base prices and dependencies
+// are taken from base and deps, as returned by compute_prices; if not provided, they are
+// computed with an additional pricing pass.
+fd_risk_t compute_risk(const std::vector<ppricer_t>& pricers, const Market& mkt, unsigned measures, ThreadPool* pool = nullptr, const portfolio_dependencies_t* deps = nullptr, const portfolio_values_t* base = nullptr);
+
+// Compute PV01 (i.e. sensitivity with respect to interest rate dV/dr), see compute_risk
+std::vector<std::pair<string, portfolio_values_t>> compute_pv01(const std::vector<ppricer_t>& pricers, const Market& mkt, ThreadPool* pool = nullptr, const portfolio_dependencies_t* deps = nullptr);
+
+// Compute the first order sensitivities of each trade with respect to all the risk
+// factors it depends on (IR rates and FX spots) via adjoint algorithmic differentiation.
+// Each trade costs one forward pricing pass recorded on a tape plus one backward sweep,
+// irrespective of the number of risk factors. Results are sorted by risk factor name.
+std::vector<std::pair<string, portfolio_values_t>> compute_sensitivities_aad(const std::vector<ppricer_t>& pricers, Market& mkt, ThreadPool* pool = nullptr);
 
 // save portfolio to file
 void save_portfolio(const string& filename, const std::vector<ptrade_t>& portfolio);
 
-// load portfolio from file
-std::vector<ptrade_t>  load_portfolio(const string& filename);
+// save portfolio to file in binary columnar format (see PortfolioColumns)
+void save_portfolio_columns(const string& filename, const portfolio_t& portfolio);
+
+// read one trade from the current line of a text portfolio
+ptrade_t load_trade(my_ifstream& is);
+
+// load portfolio from file, either in text or in binary columnar format
+// If a pool is given, a text file is split in ranges of whole lines which are
+// parsed concurrently. Trades are returned in file order in either case.
+std::vector<ptrade_t>  load_portfolio(const string& filename, ThreadPool* pool = nullptr);
 
 // print portfolio to cout
 void print_portfolio(const portfolio_t& portfolio);
@@ -0,0 +1,74 @@
+#include "PricerFXForward.h"
+#include "CurveDiscount.h"
+
+namespace minirisk {
+
+PricerFXForward::PricerFXForward(const TradeFXForward& trd)
+    : m_amt(trd.quantity())
+    , m_strike(trd.strike())
+    , m_fixing(trd.fixing_date())
+    , m_settle(trd.settlement_date())
+    , m_ccy1(trd.ccy1())
+    , m_ccy2(trd.ccy2())
+    , m_ir_curve1(ir_curve_discount_name(trd.ccy1()))
+    , m_ir_curve2(ir_curve_discount_name(trd.ccy2()))
+    , m_fx_ccy1(trd.ccy1() == "USD" ? "" : fx_spot_name(trd.ccy1(), "USD"))
+    , m_fx_ccy2(trd.ccy2() == "USD" ? "" : fx_spot_name(trd.ccy2(), "USD"))
+    , m_layout(0)
+{
+}
+
+void PricerFXForward::bind(Market& mkt) const
+{
+    m_ir_curve1_handle = mkt.bind_discount_curve(m_ir_curve1);
+    m_ir_curve2_handle = mkt.bind_discount_curve(m_ir_curve2);
+    if (!m_fx_ccy1.empty())
+        m_fx1_handle = mkt.bind_fx_spot(m_fx_ccy1);
+    if (!m_fx_ccy2.empty())
+        m_fx2_handle = mkt.bind_fx_spot(m_fx_ccy2);
+    m_layout = mkt.layout_id();
+}
+
+double PricerFXForward::price(Market& mkt) const
+{
+    MYASSERT(!(m_fixing < mkt.today()), "Fixing not found: " << fx_spot_name(m_ccy1, m_ccy2) << "," << m_fixing);
+
+    const ICurveDiscount *disc1, *disc2;
+    double fx1 = 1.0, fx2 = 1.0; // value in USD of one unit of ccy1 and ccy2
+    if (m_layout == mkt.layout_id()) {
+        // fast path: no lookup by name
+        disc1 = mkt.discount_curve(m_ir_curve1_handle);
+        disc2 = mkt.discount_curve(m_ir_curve2_handle);
+        if (!m_fx_ccy1.empty())
+            fx1 = mkt.risk_factor(m_fx1_handle);
+        if (!m_fx_ccy2.empty())
+            fx2 = mkt.risk_factor(m_fx2_handle);
+    }
+    else {
+        disc1 = mkt.get_discount_curve(m_ir_curve1).get();
+        disc2 = mkt.get_discount_curve(m_ir_curve2).get();
+        if (!m_fx_ccy1.empty())
+            fx1 = mkt.get_fx_spot(m_fx_ccy1);
+        if (!m_fx_ccy2.empty())
+            fx2 = mkt.get_fx_spot(m_fx_ccy2);
+    }
+
+    // forward rate of ccy1 in ccy2, then value in ccy2 converted in USD
+    double fwd = fx1 / fx2 * disc1->df(m_fixing) / disc2->df(m_fixing);
+    return m_amt * disc2->df(m_settle) * (fwd - m_strike) * fx2;
+}
+
+ADouble PricerFXForward::price(Market& mkt, Tape& tape) const
+{
+    MYASSERT(!(m_fixing < mkt.today()), "Fixing not found: " << fx_spot_name(m_ccy1, m_ccy2) << "," << m_fixing);
+
+    ptr_disc_curve_t disc1 = mkt.get_discount_curve(m_ir_curve1);
+    ptr_disc_curve_t disc2 = mkt.get_discount_curve(m_ir_curve2);
+    ADouble fx1 = m_fx_ccy1.empty() ? ADouble(1.0) : mkt.get_fx_spot(m_fx_ccy1, tape);
+    ADouble fx2 = m_fx_ccy2.empty() ? ADouble(1.0) : mkt.get_fx_spot(m_fx_ccy2, tape);
+
+    ADouble fwd = fx1 / fx2 * disc1->df(m_fixing, tape) / disc2->df(m_fixing, tape);
+    return m_amt * disc2->df(m_settle, tape) * (fwd - m_strike) * fx2;
+}
+
+} // namespace minirisk
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "IPricer.h"
+#include "TradeFXForward.h"
+
+namespace minirisk {
+
+// The forward rate for the fixing date T1 follows from the covered interest parity,
+// F = S * DF1(T1) / DF2(T1), where S is the spot rate of ccy1 in ccy2 and DF1, DF2 are
+// the discount factors of the two currencies. The value in ccy2 is
+//   quantity * DF2(T2) * (F - strike)
+// where T2 is the settlement date, converted to USD at the spot rate of ccy2.
+// Trades fixed before today would require the historical fixing, which is not available.
+struct PricerFXForward final : IPricer
+{
+    PricerFXForward(const TradeFXForward& trd);
+
+    virtual double price(Market& m) const;
+    virtual ADouble price(Market& m, Tape& tape) const;
+    virtual void bind(Market& m) const;
+
+    // after the fixing date the value depends on the fixing, hence on the history of the market
+    virtual Date maturity() const { return m_fixing; }
+    virtual const string& ccy() const { return m_ccy2; }
+
+private:
+    double m_amt;
+    double m_strike;
+    Date   m_fixing;
+    Date   m_settle;
+    string m_ccy1;
+    string m_ccy2;
+    string m_ir_curve1;
+    string m_ir_curve2;
+    string m_fx_ccy1; // empty for USD
+    string m_fx_ccy2; // empty for USD
+
+    // handles resolved by bind, only valid for markets with layout id m_layout
+    mutable size_t m_layout;
+    mutable size_t m_ir_curve1_handle;
+    mutable size_t m_ir_curve2_handle;
+    mutable size_t m_fx1_handle;
+    mutable size_t m_fx2_handle;
+};
+
+} // namespace minirisk
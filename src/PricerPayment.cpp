@@ -7,13 +7,31 @@ namespace minirisk {
 PricerPayment::PricerPayment(const TradePayment& trd)
     : m_amt(trd.quantity())
     , m_dt(trd.delivery_date())
+    , m_ccy(trd.ccy())
     , m_ir_curve(ir_curve_discount_name(trd.ccy()))
     , m_fx_ccy(trd.ccy() == "USD" ? "" : fx_spot_name(trd.ccy(),"USD"))
+    , m_layout(0)
 {
 }
 
+void PricerPayment::bind(Market& mkt) const
+{
+    m_ir_curve_handle = mkt.bind_discount_curve(m_ir_curve);
+    if (!m_fx_ccy.empty())
+        m_fx_handle = mkt.bind_fx_spot(m_fx_ccy);
+    m_layout = mkt.layout_id();
+}
+
 double PricerPayment::price(Market& mkt) const
 {
+    if (m_layout == mkt.layout_id()) {
+        // fast path: no lookup by name
+        double df = mkt.discount_curve(m_ir_curve_handle)->df(m_dt);
+        if (!m_fx_ccy.empty())
+            df *= mkt.risk_factor(m_fx_handle);
+        return m_amt * df;
+    }
+
     ptr_disc_curve_t disc = mkt.get_discount_curve(m_ir_curve);
     double df = disc->df(m_dt); // this throws an exception if m_dt<today
 
@@ -24,6 +42,18 @@ double PricerPayment::price(Market& mkt) const
     return m_amt * df;
 }
 
+ADouble PricerPayment::price(Market& mkt, Tape& tape) const
+{
+    ptr_disc_curve_t disc = mkt.get_discount_curve(m_ir_curve);
+    ADouble df = disc->df(m_dt, tape); // this throws an exception if m_dt<today
+
+    // This PV is expressed in m_ccy. It must be converted in USD.
+    if (!m_fx_ccy.empty())
+        df = df * mkt.get_fx_spot(m_fx_ccy, tape);
+
+    return m_amt * df;
+}
+
 } // namespace minirisk
 
 
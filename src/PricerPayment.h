@@ -5,17 +5,29 @@
 
 namespace minirisk {
 
-struct PricerPayment : IPricer
+struct PricerPayment final : IPricer
 {
+    friend struct PricerPaymentBatch;
+
     PricerPayment(const TradePayment& trd);
 
     virtual double price(Market& m) const;
+    virtual ADouble price(Market& m, Tape& tape) const;
+    virtual void bind(Market& m) const;
+    virtual Date maturity() const { return m_dt; }
+    virtual const string& ccy() const { return m_ccy; }
 
 private:
     double m_amt;
     Date   m_dt;
+    string m_ccy;
     string m_ir_curve;
     string m_fx_ccy;
+
+    // handles resolved by bind, only valid for markets with layout id m_layout
+    mutable size_t m_layout;
+    mutable size_t m_ir_curve_handle;
+    mutable size_t m_fx_handle;
 };
 
 } // namespace minirisk
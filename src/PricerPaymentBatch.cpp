@@ -0,0 +1,117 @@
+#include "PricerPaymentBatch.h"
+#include "PricerPayment.h"
+#include "ThreadPool.h"
+#include "PortfolioColumns.h"
+#include "TradePayment.h"
+
+#include <algorithm>
+#include <map>
+
+namespace minirisk {
+
+namespace {
+
+// number of trades priced together, large enough to amortize the curve lookup
+// and small enough for the buffers to stay in L1 cache
+const size_t block_size = 1024;
+
+} // anonymous namespace
+
+PricerPaymentBatch::PricerPaymentBatch(const std::vector<ppricer_t>& pricers)
+    : m_size(pricers.size())
+{
+    std::map<string, size_t> groups;
+    for (size_t i = 0; i < pricers.size(); ++i) {
+        const PricerPayment* p = dynamic_cast<const PricerPayment*>(pricers[i].get());
+        if (!p) {
+            m_others.emplace_back(i, pricers[i]);
+            continue;
+        }
+        group_t& g = group(groups, p->m_ir_curve, p->m_fx_ccy);
+        g.m_index.push_back(i);
+        g.m_amt.push_back(p->m_amt);
+        g.m_dt.push_back(p->m_dt);
+    }
+    make_blocks();
+}
+
+PricerPaymentBatch::PricerPaymentBatch(const PortfolioColumns& columns)
+    : m_size(columns.size())
+{
+    std::map<string, size_t> groups;
+    for (size_t i = 0; i < columns.size(); ++i) {
+        if (columns.type()[i] != TradePayment::m_id) {
+            m_others.emplace_back(i, columns.trades(i, i + 1)[0]->pricer());
+            continue;
+        }
+        // same market objects as PricerPayment
+        const string ccy = PortfolioColumns::ccy_name(columns.ccy()[i]);
+        group_t& g = group(groups, ir_curve_discount_name(ccy), ccy == "USD" ? "" : fx_spot_name(ccy, "USD"));
+        g.m_index.push_back(i);
+        g.m_amt.push_back(columns.quantity()[i]);
+        g.m_dt.push_back(Date(columns.delivery()[i]));
+    }
+    make_blocks();
+}
+
+PricerPaymentBatch::group_t& PricerPaymentBatch::group(std::map<string, size_t>& groups, const string& ir_curve, const string& fx_ccy)
+{
+    auto ins = groups.emplace(ir_curve, m_groups.size());
+    if (ins.second) {
+        m_groups.emplace_back();
+        m_groups.back().m_ir_curve = ir_curve;
+        m_groups.back().m_fx_ccy = fx_ccy;
+    }
+    return m_groups[ins.first->second];
+}
+
+void PricerPaymentBatch::make_blocks()
+{
+    for (size_t g = 0; g < m_groups.size(); ++g)
+        for (size_t b = 0, n = m_groups[g].m_index.size(); b < n; b += block_size)
+            m_blocks.push_back(block_t{ g, b, std::min(n, b + block_size) });
+}
+
+void PricerPaymentBatch::price_block(const block_t& b, Market& mkt, portfolio_values_t& prices) const
+{
+    const group_t& g = m_groups[b.group];
+    const size_t n = b.end - b.begin;
+
+    double df[block_size];
+    ptr_disc_curve_t disc = mkt.get_discount_curve(g.m_ir_curve);
+    disc->df(std::span<const Date>(g.m_dt.data() + b.begin, n), std::span<double>(df, n));
+
+    // This PV is expressed in the group currency. It must be converted in USD.
+    if (!g.m_fx_ccy.empty()) {
+        const double fx = mkt.get_fx_spot(g.m_fx_ccy);
+        for (size_t i = 0; i < n; ++i)
+            df[i] *= fx;
+    }
+
+    const double* amt = g.m_amt.data() + b.begin;
+    const size_t* index = g.m_index.data() + b.begin;
+    for (size_t i = 0; i < n; ++i)
+        prices[index[i]] = amt[i] * df[i];
+}
+
+portfolio_values_t PricerPaymentBatch::price(Market& mkt, ThreadPool* pool) const
+{
+    portfolio_values_t prices(m_size);
+
+    auto price_blocks = [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k)
+            price_block(m_blocks[k], mkt, prices);
+    };
+
+    if (pool_size(pool) == 1)
+        price_blocks(0, m_blocks.size());
+    else
+        pool->parallel_for(m_blocks.size(), 1, price_blocks);
+
+    for (const auto& p : m_others)
+        prices[p.first] = p.second->price(mkt);
+
+    return prices;
+}
+
+} // namespace minirisk
@@ -0,0 +1,125 @@
+#include "Profiler.h"
+#include "Macros.h"
+
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <new>
+
+namespace minirisk {
+
+std::atomic<bool> profiler::s_enabled(false);
+std::atomic<uint64_t> profiler::s_allocations(0);
+std::atomic<uint64_t> profiler::s_bytes(0);
+
+namespace {
+
+struct registry_t
+{
+    std::mutex mutex;
+    std::deque<profile_stat_t> stats;                  // stable addresses
+    std::map<string, profile_stat_t*> timers, counters;
+
+    profile_stat_t& get(std::map<string, profile_stat_t*>& index, const string& name)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        profile_stat_t*& s = index[name];
+        if (!s)
+            s = &stats.emplace_back();
+        return *s;
+    }
+};
+
+registry_t& registry()
+{
+    static registry_t r;
+    return r;
+}
+
+} // anonymous namespace
+
+void profile_allocation(size_t bytes)
+{
+    if (profiler::enabled()) {
+        profiler::s_allocations.fetch_add(1, std::memory_order_relaxed);
+        profiler::s_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+}
+
+profile_stat_t& profiler::timer(const string& name)
+{
+    return registry().get(registry().timers, name);
+}
+
+profile_stat_t& profiler::counter(const string& name)
+{
+    return registry().get(registry().counters, name);
+}
+
+void profiler::report(std::ostream& os)
+{
+    registry_t& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    os << std::fixed << std::setprecision(3)
+       << "{\n"
+       << "  \"allocations\": " << allocations() << ",\n"
+       << "  \"allocated_bytes\": " << allocated_bytes() << ",\n"
+       << "  \"timers\": {";
+    const char* sep = "\n";
+    for (const auto& t : r.timers) {
+        const profile_stat_t& s = *t.second;
+        os << sep << "    \"" << t.first << "\": { "
+           << "\"calls\": " << s.calls.load() << ", "
+           << "\"total_ms\": " << s.ns.load() * 1e-6 << ", "
+           << "\"max_ms\": " << s.max_ns.load() * 1e-6 << ", "
+           << "\"allocations\": " << s.allocations.load() << ", "
+           << "\"allocated_bytes\": " << s.bytes.load() << " }";
+        sep = ",\n";
+    }
+    os << "\n  },\n"
+       << "  \"counters\": {";
+    sep = "\n";
+    for (const auto& c : r.counters) {
+        os << sep << "    \"" << c.first << "\": " << c.second->calls.load();
+        sep = ",\n";
+    }
+    os << "\n  }\n"
+       << "}\n";
+    os << std::defaultfloat;
+}
+
+void profiler::report(const string& filename)
+{
+    std::ofstream os(filename);
+    MYASSERT(os, "Cannot open file " << filename);
+    report(os);
+}
+
+} // namespace minirisk
+
+#ifndef NO_PROFILE
+
+// Count the heap allocations. The other forms of new and delete (arrays, nothrow,
+// sized) forward to these ones; aligned allocations are not counted.
+void* operator new(size_t bytes)
+{
+    minirisk::profile_allocation(bytes);
+    if (void* p = std::malloc(bytes ? bytes : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+#endif
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+#include "Global.h"
+
+namespace minirisk {
+
+// Built-in instrumentation: named scoped timers and counters, plus a count of the
+// heap allocations made while each timer is running.
+// Everything is off until profiler::enable() is called: a disabled probe costs one
+// relaxed load of a global flag. Building with -DNO_PROFILE (make PROFILE=0) removes
+// the probes and the allocation hooks altogether.
+// Probe names must be string literals; counters with computed names can be updated
+// through profiler::counter. Statistics are shared by all threads: the time of
+// a scope entered concurrently by several threads is the sum of their times, and its
+// allocations are the ones made by any thread while the scope is running.
+
+// statistics of a timer or a counter, updated atomically
+struct profile_stat_t
+{
+    std::atomic<uint64_t> calls{ 0 };  // scopes completed, or counter increments
+    std::atomic<uint64_t> ns{ 0 };     // total time in the scope
+    std::atomic<uint64_t> max_ns{ 0 }; // longest single run of the scope
+    std::atomic<uint64_t> allocations{ 0 };
+    std::atomic<uint64_t> bytes{ 0 };
+
+    void add(uint64_t n) { calls.fetch_add(n, std::memory_order_relaxed); }
+};
+
+struct profiler
+{
+    static bool enabled()
+    {
+#ifdef NO_PROFILE
+        return false;
+#else
+        return s_enabled.load(std::memory_order_relaxed);
+#endif
+    }
+
+    static void enable() { s_enabled.store(true); }
+
+    // the statistics of a timer or counter, created on first use.
+    // The address is stable, so that probes can look it up once and keep it.
+    static profile_stat_t& timer(const string& name);
+    static profile_stat_t& counter(const string& name);
+
+    // heap allocations made by all threads since the program started, counted
+    // only while the profiler is enabled
+    static uint64_t allocations() { return s_allocations.load(std::memory_order_relaxed); }
+    static uint64_t allocated_bytes() { return s_bytes.load(std::memory_order_relaxed); }
+
+    // JSON report of all the timers and counters, sorted by name
+    static void report(std::ostream& os);
+    static void report(const string& filename);
+
+private:
+    friend void profile_allocation(size_t bytes);
+
+    static std::atomic<bool> s_enabled;
+    static std::atomic<uint64_t> s_allocations;
+    static std::atomic<uint64_t> s_bytes;
+};
+
+// times the enclosing scope, if the profiler is enabled when the scope is entered
+struct profile_scope_t
+{
+    typedef std::chrono::steady_clock clock_t;
+
+    profile_scope_t(profile_stat_t* stat)
+        : m_stat(stat)
+    {
+        if (m_stat) {
+            m_allocations = profiler::allocations();
+            m_bytes = profiler::allocated_bytes();
+            m_start = clock_t::now();
+        }
+    }
+
+    ~profile_scope_t()
+    {
+        if (!m_stat)
+            return;
+        const uint64_t ns = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(clock_t::now() - m_start).count());
+        m_stat->calls.fetch_add(1, std::memory_order_relaxed);
+        m_stat->ns.fetch_add(ns, std::memory_order_relaxed);
+        m_stat->allocations.fetch_add(profiler::allocations() - m_allocations, std::memory_order_relaxed);
+        m_stat->bytes.fetch_add(profiler::allocated_bytes() - m_bytes, std::memory_order_relaxed);
+        uint64_t prev = m_stat->max_ns.load(std::memory_order_relaxed);
+        while (prev < ns && !m_stat->max_ns.compare_exchange_weak(prev, ns, std::memory_order_relaxed))
+            ;
+    }
+
+    profile_scope_t(const profile_scope_t&) = delete;
+    profile_scope_t& operator=(const profile_scope_t&) = delete;
+
+private:
+    profile_stat_t* m_stat;
+    uint64_t m_allocations;
+    uint64_t m_bytes;
+    clock_t::time_point m_start;
+};
+
+} // namespace minirisk
+
+// Probes. The statistics are looked up once per call site, the first time the
+// probe runs with the profiler enabled.
+#ifdef NO_PROFILE
+#    define PROFILE_SCOPE(name)
+#    define PROFILE_COUNT(name, n) do { } while (0)
+#else
+#    define PROFILE_CONCAT_(a, b) a##b
+#    define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#    define PROFILE_SCOPE(name) \
+        ::minirisk::profile_scope_t PROFILE_CONCAT(profile_scope_, __LINE__)( \
+            ::minirisk::profiler::enabled() \
+                ? [] { static ::minirisk::profile_stat_t& s = ::minirisk::profiler::timer(name); return &s; }() \
+                : nullptr)
+#    define PROFILE_COUNT(name, n) \
+        do { \
+            if (::minirisk::profiler::enabled()) { \
+                static ::minirisk::profile_stat_t& s = ::minirisk::profiler::counter(name); \
+                s.add(n); \
+            } \
+        } while (0)
+#endif
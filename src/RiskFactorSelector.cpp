@@ -0,0 +1,192 @@
+#include "RiskFactorSelector.h"
+#include "Macros.h"
+
+#include <cctype>
+#include <cstring>
+#include <limits>
+
+namespace minirisk {
+
+namespace {
+
+const size_t unbounded = std::numeric_limits<size_t>::max();
+
+// parse a non negative integer at expr[i], advancing i
+bool parse_count(const string& expr, size_t& i, size_t& n)
+{
+    size_t b = i;
+    n = 0;
+    while (i < expr.size() && std::isdigit((unsigned char)expr[i]))
+        n = n * 10 + size_t(expr[i++] - '0');
+    return i > b;
+}
+
+} // anonymous namespace
+
+RiskFactorSelector::RiskFactorSelector(const string& pattern)
+    : m_pattern(pattern)
+{
+    bool compiled = compile();
+
+    // if compilation stopped, the elements parsed so far are still a valid prefix,
+    // unless the pattern has alternatives
+    if (!compiled && pattern.find('|') != string::npos)
+        m_elements.clear();
+
+    // the leading elements matching exactly one given character form the prefix
+    size_t n = 0;
+    for (; n < m_elements.size(); ++n) {
+        const element_t& e = m_elements[n];
+        if (e.min != 1 || e.max != 1 || e.chars.count() != 1)
+            break;
+        for (size_t c = 0; c < 256; ++c)
+            if (e.chars[c]) {
+                m_prefix += char(c);
+                break;
+            }
+    }
+    m_elements.erase(m_elements.begin(), m_elements.begin() + n);
+
+    if (!compiled) {
+        m_elements.clear();
+        m_regex.reset(new std::regex(pattern));
+    }
+}
+
+bool RiskFactorSelector::compile()
+{
+    const string& p = m_pattern;
+    size_t i = 0;
+    while (i < p.size()) {
+        element_t e;
+        e.min = e.max = 1;
+        char c = p[i];
+        if (c == '\\') {
+            // escaped metacharacter; classes like \d are left to std::regex
+            if (i + 1 == p.size() || !std::ispunct((unsigned char)p[i + 1]))
+                return false;
+            e.chars.set((unsigned char)p[i + 1]);
+            i += 2;
+        }
+        else if (c == '.') {
+            e.chars.set();
+            ++i;
+        }
+        else if (c == '[') {
+            ++i;
+            bool negate = i < p.size() && p[i] == '^';
+            if (negate)
+                ++i;
+            if (i < p.size() && p[i] == ']')
+                return false; // empty class
+            while (i < p.size() && p[i] != ']') {
+                unsigned char lo = p[i];
+                if (lo == '\\' || lo == '[')
+                    return false; // escapes and named classes
+                unsigned char hi = lo;
+                if (i + 2 < p.size() && p[i + 1] == '-' && p[i + 2] != ']') {
+                    hi = p[i + 2];
+                    i += 2;
+                }
+                if (hi < lo)
+                    return false;
+                for (size_t k = lo; k <= hi; ++k)
+                    e.chars.set(k);
+                ++i;
+            }
+            if (i == p.size())
+                return false; // unterminated class
+            ++i;
+            if (negate)
+                e.chars.flip();
+        }
+        else if (std::strchr("()|^$*+?{}]", c))
+            return false;
+        else {
+            e.chars.set((unsigned char)c);
+            ++i;
+        }
+
+        // repetition
+        if (i < p.size()) {
+            switch (p[i]) {
+            case '*': e.min = 0; e.max = unbounded; ++i; break;
+            case '+': e.min = 1; e.max = unbounded; ++i; break;
+            case '?': e.min = 0; e.max = 1; ++i; break;
+            case '{':
+                ++i;
+                if (!parse_count(p, i, e.min))
+                    return false;
+                e.max = e.min;
+                if (i < p.size() && p[i] == ',') {
+                    ++i;
+                    if (!parse_count(p, i, e.max))
+                        e.max = unbounded;
+                }
+                if (i == p.size() || p[i] != '}' || e.max < e.min)
+                    return false;
+                ++i;
+                break;
+            }
+            // lazy and possessive quantifiers
+            if (i < p.size() && std::strchr("*+?{", p[i]))
+                return false;
+        }
+        m_elements.push_back(e);
+    }
+    return true;
+}
+
+bool RiskFactorSelector::match_from(std::string_view name, size_t elem, size_t pos) const
+{
+    // consume single character elements without recursion
+    while (elem < m_elements.size() && m_elements[elem].min == 1 && m_elements[elem].max == 1) {
+        if (pos == name.size() || !m_elements[elem].chars[(unsigned char)name[pos]])
+            return false;
+        ++elem;
+        ++pos;
+    }
+    if (elem == m_elements.size())
+        return pos == name.size();
+
+    // repeated element: take as many characters as possible, then backtrack
+    const element_t& e = m_elements[elem];
+    size_t n = 0;
+    while (n < e.max && pos + n < name.size() && e.chars[(unsigned char)name[pos + n]])
+        ++n;
+    for (size_t k = n + 1; k-- > e.min; )
+        if (match_from(name, elem + 1, pos + k))
+            return true;
+    return false;
+}
+
+bool RiskFactorSelector::matches(const string& name) const
+{
+    if (name.compare(0, m_prefix.size(), m_prefix) != 0)
+        return false;
+    if (m_regex)
+        return std::regex_match(name, *m_regex);
+    return match_from(name, 0, m_prefix.size());
+}
+
+std::vector<size_t> RiskFactorSelector::select(const SymbolTable& symbols) const
+{
+    std::vector<size_t> ids;
+    auto range = symbols.prefix_range(m_prefix);
+    if (!m_regex && m_elements.empty()) {
+        // literal pattern
+        size_t id = symbols.find(m_prefix);
+        if (id != SymbolTable::npos)
+            ids.push_back(id);
+        return ids;
+    }
+    for (size_t id = range.first; id < range.second; ++id)
+    {
+        std::string_view name = symbols.name(id);
+        if (m_regex ? std::regex_match(name.begin(), name.end(), *m_regex) : match_from(name, 0, m_prefix.size()))
+            ids.push_back(id);
+    }
+    return ids;
+}
+
+} // namespace minirisk
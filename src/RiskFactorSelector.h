@@ -0,0 +1,57 @@
+#pragma once
+
+#include <bitset>
+#include <memory>
+#include <regex>
+#include <vector>
+
+#include "Global.h"
+#include "SymbolTable.h"
+
+namespace minirisk {
+
+// Precompiled selection of risk factors by name, for the patterns used to query
+// markets, e.g. "IR\.[A-Z]{3}", "FX\.SPOT\..*" or ".+".
+// Patterns use the regular expression syntax. The following subset is compiled to a
+// sequence of elements matched directly, without std::regex:
+//  - literal characters, including escaped metacharacters (e.g. "\.")
+//  - "." (any character) and character classes (e.g. "[A-Z]", "[^.]")
+//  - each optionally repeated by "*", "+", "?", "{n}", "{n,}" or "{n,m}"
+// Anything else (alternatives, groups, anchors, ...) falls back to std::regex.
+// In both cases the literal prefix of the pattern restricts the names to test to a
+// contiguous range of a SymbolTable.
+// A selector is immutable, so it can be built once and shared across threads.
+struct RiskFactorSelector
+{
+    RiskFactorSelector(const string& pattern);
+
+    const string& pattern() const { return m_pattern; }
+
+    // true if name matches the whole pattern
+    bool matches(const string& name) const;
+
+    // ids of the symbols matching the pattern, in increasing order
+    std::vector<size_t> select(const SymbolTable& symbols) const;
+
+    // true if the pattern is evaluated via std::regex
+    bool is_regex() const { return m_regex != nullptr; }
+
+private:
+    struct element_t
+    {
+        std::bitset<256> chars; // characters accepted
+        size_t min;             // minimum number of repetitions
+        size_t max;             // maximum number of repetitions
+    };
+
+    bool compile();
+    bool match_from(std::string_view name, size_t elem, size_t pos) const;
+
+private:
+    string m_pattern;
+    string m_prefix;                      // literal prefix of all matching names
+    std::vector<element_t> m_elements;    // compiled pattern, after the prefix
+    std::shared_ptr<const std::regex> m_regex; // fallback
+};
+
+} // namespace minirisk
@@ -0,0 +1,105 @@
+#include "RiskSweep.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <mutex>
+
+namespace minirisk {
+
+RiskSweep::RiskSweep(const std::vector<ppricer_t>& pricers, const Market& mkt, ThreadPool* pool, const portfolio_dependencies_t* deps, const portfolio_values_t* base)
+    : m_pricers(pricers)
+    , m_mkt(mkt)
+    , m_pool(pool)
+    , m_deps(deps)
+    , m_base(base)
+    , m_done(0)
+{
+    // one base pricing pass, recording the dependencies if they are also missing
+    if (!m_base || !m_deps) {
+        Market tmpmkt(mkt);
+        m_own_base = compute_prices(pricers, tmpmkt, pool, m_deps ? nullptr : &m_own_deps);
+        if (!m_base)
+            m_base = &m_own_base;
+        if (!m_deps)
+            m_deps = &m_own_deps;
+    }
+    MYASSERT(m_base->size() == pricers.size() && m_deps->size() == pricers.size(), "Base prices and dependencies do not match the portfolio");
+}
+
+size_t RiskSweep::add_state(const Market::vec_risk_factor_t& values)
+{
+    auto i = m_index.emplace(values, m_states.size());
+    if (i.second)
+        m_states.push_back(values);
+    return i.first->second;
+}
+
+void RiskSweep::run()
+{
+    const size_t first = m_done, n_states = m_states.size() - first;
+    if (n_states == 0)
+        return;
+    PROFILE_SCOPE("risk.sweep");
+    PROFILE_COUNT("risk.bump_states", n_states);
+
+    // all the bumped states up front; curves are built by the first trade using them
+    std::vector<Market> markets(n_states, m_mkt);
+    std::map<string, std::vector<size_t>> by_factor; // states bumping each risk factor
+    for (size_t s = 0; s < n_states; ++s) {
+        markets[s].set_risk_factors(m_states[first + s]);
+        for (const auto& rf : m_states[first + s])
+            by_factor[rf.first].push_back(s);
+    }
+    m_prices.resize(m_states.size(), *m_base);
+
+    // reprices under each state, only counted when profiling
+    std::vector<size_t> state_reprices(profiler::enabled() ? n_states : 0);
+    std::mutex state_reprices_mutex;
+
+    // trade major: each trade is priced under all the relevant states in turn
+    auto price_range = [&](size_t begin, size_t end)
+    {
+        std::vector<size_t> sel, counts(state_reprices.size());
+        size_t reprices = 0;
+        for (size_t t = begin; t < end; ++t) {
+            sel.clear();
+            for (const string& name : (*m_deps)[t]) {
+                auto i = by_factor.find(name);
+                if (i != by_factor.end())
+                    sel.insert(sel.end(), i->second.begin(), i->second.end());
+            }
+            std::sort(sel.begin(), sel.end());
+            sel.erase(std::unique(sel.begin(), sel.end()), sel.end());
+            for (size_t s : sel)
+                m_prices[first + s][t] = m_pricers[t]->price(markets[s]);
+            reprices += sel.size();
+            if (!counts.empty())
+                for (size_t s : sel)
+                    ++counts[s];
+        }
+        // trades not depending on a bumped risk factor keep the base price
+        PROFILE_COUNT("risk.reprices", reprices);
+        PROFILE_COUNT("risk.reprices_skipped", (end - begin) * n_states - reprices);
+        if (!counts.empty()) {
+            std::lock_guard<std::mutex> lock(state_reprices_mutex);
+            for (size_t s = 0; s < counts.size(); ++s)
+                state_reprices[s] += counts[s];
+        }
+    };
+
+    if (pool_size(m_pool) == 1)
+        price_range(0, m_pricers.size());
+    else
+        m_pool->parallel_for(m_pricers.size(), m_pool->default_chunk(m_pricers.size()), price_range);
+
+    // reprices per bumped risk factor, e.g. risk.reprices.IR.EUR; the states of cross
+    // gammas count for both their risk factors
+    for (size_t s = 0; s < state_reprices.size(); ++s)
+        for (const auto& rf : m_states[first + s])
+            profiler::counter("risk.reprices." + rf.first).add(state_reprices[s]);
+
+    m_done = m_states.size();
+}
+
+} // namespace minirisk
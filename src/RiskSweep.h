@@ -0,0 +1,68 @@
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "PortfolioUtils.h"
+
+namespace minirisk {
+
+struct ThreadPool;
+
+// Prices a portfolio under a set of bumped market states in a single pass over the trades.
+// All the states are registered first, then run() builds one market per state and walks
+// the trades once, pricing each trade under all the states bumping a risk factor it
+// reads, one after the other while the trade's data is hot. Trades not reading any of
+// the bumped risk factors keep their base price, so finite difference estimators can
+// combine any states without knowing which trades they affect.
+// The base prices and dependencies are computed once, unless the caller provides them.
+struct RiskSweep
+{
+    // base and deps, if given, must be the prices and dependencies of the pricers in mkt
+    // (see compute_prices), and must outlive the sweep
+    RiskSweep(const std::vector<ppricer_t>& pricers, const Market& mkt, ThreadPool* pool = nullptr, const portfolio_dependencies_t* deps = nullptr, const portfolio_values_t* base = nullptr);
+
+    // register a state where the given risk factors take the given values, returns its index.
+    // Registering the same state twice returns the same index.
+    size_t add_state(const Market::vec_risk_factor_t& values);
+
+    // register the risk factor shifted by an absolute amount
+    size_t add_bump(const Market::risk_factor_t& rf, double shift)
+    {
+        return add_state(Market::vec_risk_factor_t(1, Market::risk_factor_t(rf.first, rf.second + shift)));
+    }
+
+    // price all the states registered since the last run
+    void run();
+
+    size_t size() const { return m_states.size(); }
+
+    const portfolio_values_t& base() const { return *m_base; }
+
+    // prices under state s, which must have been run
+    const portfolio_values_t& prices(size_t s) const
+    {
+        MYASSERT(s < m_done, "State " << s << " has not been priced yet");
+        return m_prices[s];
+    }
+
+    // risk factors read by each trade
+    const portfolio_dependencies_t& dependencies() const { return *m_deps; }
+
+private:
+    const std::vector<ppricer_t>& m_pricers;
+    const Market& m_mkt;
+    ThreadPool* m_pool;
+
+    portfolio_dependencies_t m_own_deps;
+    portfolio_values_t m_own_base;
+    const portfolio_dependencies_t* m_deps;
+    const portfolio_values_t* m_base;
+
+    std::vector<Market::vec_risk_factor_t> m_states;
+    std::map<Market::vec_risk_factor_t, size_t> m_index;
+    std::vector<portfolio_values_t> m_prices;
+    size_t m_done; // states already priced
+};
+
+} // namespace minirisk
@@ -6,6 +6,12 @@
 #include <fstream>
 #include <sstream>
 #include <iomanip>
+#include <charconv>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <cctype>
+#include <string_view>
 
 #include "Global.h"
 #include "Date.h"
@@ -26,37 +32,92 @@ struct my_ofstream
         : m_of(fn)
     {
     }
-    void endl() { m_of << std::endl; }
+    void endl() { m_of << '\n'; }
     void close() { m_of.close(); }
     std::ofstream m_of;
 };
 
+// Reads text files made of lines of tokens separated by ';'.
+// Lines are tokenized in place within a large buffer: tokens are returned as views
+// into the buffer, so reading a file does no per line or per field allocation.
+// The reader works either on a file, read in large blocks, or on a range of memory
+// (e.g. a memory mapped file), which is not copied.
 struct my_ifstream
 {
     my_ifstream(const string& fn)
-        : m_if(fn)
+        : m_if(fn, std::ios::binary)
+        , m_buf(buffer_size)
+        , m_pos(m_buf.data())
+        , m_end(m_buf.data())
+        , m_tok(m_buf.data())
+        , m_line_end(m_buf.data())
     {
         MYASSERT(!m_if.fail(), "Could not open file " << fn);
     }
 
+    my_ifstream(const char* begin, const char* end)
+        : m_pos(begin)
+        , m_end(end)
+        , m_tok(begin)
+        , m_line_end(begin)
+    {
+    }
+
+    // move to the next line, returns false at the end of the file or on an empty line
     bool read_line()
     {
-        std::getline(m_if, m_line);  // read a line and store it in m_line
-        m_line_stream.str(m_line);   // associate a string stream with m_line
-        return m_line.length() > 0;
+        const char* nl;
+        while (!(nl = static_cast<const char*>(std::memchr(m_pos, '\n', m_end - m_pos))) && refill())
+            ;
+        m_tok = m_pos;
+        m_line_end = nl ? nl : m_end;
+        m_pos = nl ? nl + 1 : m_end;
+        return m_line_end > m_tok;
     }
 
-    inline string read_token()
+    // true if the last call to read_line reached the end of the data, rather than an empty line
+    bool eof() const
     {
-        string tmp;
-        std::getline(m_line_stream, tmp, separator);
-        return tmp;
+        return m_pos == m_end && m_line_end == m_end;
+    }
+
+    // next token of the current line, empty if there are no more tokens.
+    // The view is valid until the next call to read_line.
+    std::string_view read_token()
+    {
+        const char* sep = static_cast<const char*>(std::memchr(m_tok, separator, m_line_end - m_tok));
+        const char* e = sep ? sep : m_line_end;
+        std::string_view tok(m_tok, e - m_tok);
+        m_tok = sep ? sep + 1 : m_line_end;
+        return tok;
+    }
+
+private:
+    static const size_t buffer_size = size_t(1) << 20;
+
+    // move the unread data to the front of the buffer and append more data from the
+    // file, growing the buffer if a line does not fit. Returns false at end of file.
+    bool refill()
+    {
+        if (!m_if.is_open() || m_if.eof())
+            return false;
+        size_t left = m_end - m_pos;
+        std::memmove(m_buf.data(), m_pos, left); // before growing, which moves the buffer
+        if (left == m_buf.size())
+            m_buf.resize(2 * m_buf.size());
+        m_if.read(m_buf.data() + left, m_buf.size() - left);
+        m_pos = m_buf.data();
+        m_end = m_buf.data() + left + m_if.gcount();
+        return m_if.gcount() > 0;
     }
 
 private:
-    string m_line;
-    std::istringstream m_line_stream;
     std::ifstream m_if;
+    std::vector<char> m_buf;
+    const char* m_pos;      // beginning of the unread data
+    const char* m_end;      // end of the available data
+    const char* m_tok;      // beginning of the next token
+    const char* m_line_end; // end of the current line
 };
 
 //
@@ -66,8 +127,44 @@ private:
 template <typename T>
 inline my_ifstream& operator>>(my_ifstream& is, T& v)
 {
-    string tmp = is.read_token();
-    std::istringstream(tmp) >> v;
+    std::istringstream(string(is.read_token())) >> v;
+    return is;
+}
+
+inline my_ifstream& operator>>(my_ifstream& is, string& v)
+{
+    v.assign(is.read_token());
+    return is;
+}
+
+// strip the blanks around a numeric token and a leading '+', which istringstream
+// accepts but from_chars does not
+inline std::string_view trim_number(std::string_view tok)
+{
+    while (!tok.empty() && std::isspace((unsigned char)tok.front()))
+        tok.remove_prefix(1);
+    while (!tok.empty() && std::isspace((unsigned char)tok.back()))
+        tok.remove_suffix(1);
+    if (tok.size() > 1 && tok[0] == '+' && tok[1] != '-' && tok[1] != '+')
+        tok.remove_prefix(1);
+    return tok;
+}
+
+// parse a whole token as an integer, without allocation and independently of the locale
+template <std::integral T>
+inline T parse_integer(std::string_view tok)
+{
+    tok = trim_number(tok);
+    T v{};
+    auto res = std::from_chars(tok.data(), tok.data() + tok.size(), v);
+    MYASSERT(res.ec == std::errc() && res.ptr == tok.data() + tok.size(), "Cannot parse integer from: " << tok);
+    return v;
+}
+
+template <std::integral T>
+inline my_ifstream& operator>>(my_ifstream& is, T& v)
+{
+    v = parse_integer<T>(is.read_token());
     return is;
 }
 
@@ -90,6 +187,31 @@ inline my_ofstream& operator<<(my_ofstream& os, double v)
     return os;
 }
 
+// A double is read either in decimal notation, or as the 16 hexadecimal digits of its
+// IEEE 754 representation, optionally prefixed by 0x (e.g. 4034000000000000 is 20.0),
+// which is how the portfolio files encode them. A field of exactly 16 digits is
+// therefore always hexadecimal: larger decimals must use a decimal point or an exponent,
+// as operator<< does.
+inline my_ifstream& operator>>(my_ifstream& is, double& v)
+{
+    std::string_view tok = trim_number(is.read_token());
+    if (tok.size() == 18 && tok[0] == '0' && (tok[1] == 'x' || tok[1] == 'X'))
+        tok.remove_prefix(2);
+    const char* b = tok.data();
+    const char* e = tok.data() + tok.size();
+    if (tok.size() == 16 && std::all_of(b, e, [](char c) { return std::isxdigit((unsigned char)c); })) {
+        uint64_t bits = 0;
+        auto res = std::from_chars(b, e, bits, 16);
+        MYASSERT(res.ec == std::errc() && res.ptr == e, "Cannot parse double from: " << tok);
+        std::memcpy(&v, &bits, sizeof(v));
+    }
+    else {
+        auto res = std::from_chars(b, e, v);
+        MYASSERT(res.ec == std::errc() && res.ptr == e, "Cannot parse double from: " << tok);
+    }
+    return is;
+}
+
 
 //
 // Vector streamer overloads
@@ -141,14 +263,18 @@ inline my_ofstream& operator<<(my_ofstream& os, const Date& d)
     return os;
 }
 
+// A date is read either in YYYYMMDD format or as a serial number (see Date::serial)
 inline my_ifstream& operator>>(my_ifstream& is, Date& v)
 {
-    string tmp;
-    is >> tmp;
-    unsigned y = std::atoi(tmp.substr(0, 4).c_str());
-    unsigned m = std::atoi(tmp.substr(4, 2).c_str());
-    unsigned d = std::atoi(tmp.substr(6, 2).c_str());
-    v.init(y, m, d);
+    std::string_view tok = trim_number(is.read_token());
+    if (tok.size() == 8) {
+        unsigned y = parse_integer<unsigned>(tok.substr(0, 4));
+        unsigned m = parse_integer<unsigned>(tok.substr(4, 2));
+        unsigned d = parse_integer<unsigned>(tok.substr(6, 2));
+        v.init(y, m, d);
+    }
+    else
+        v.init_serial(parse_integer<unsigned>(tok));
     return is;
 }
 
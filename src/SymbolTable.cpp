@@ -0,0 +1,40 @@
+#include "SymbolTable.h"
+#include "Macros.h"
+
+#include <algorithm>
+
+namespace minirisk {
+
+SymbolTable::SymbolTable(std::vector<string> names)
+    : m_storage(std::move(names))
+{
+    std::sort(m_storage.begin(), m_storage.end());
+    auto dup = std::adjacent_find(m_storage.begin(), m_storage.end());
+    MYASSERT(dup == m_storage.end(), "Duplicated risk factor: " << *dup);
+    m_names.assign(m_storage.begin(), m_storage.end());
+}
+
+SymbolTable::SymbolTable(std::vector<std::string_view> names, std::shared_ptr<const void> owner)
+    : m_names(std::move(names))
+    , m_owner(std::move(owner))
+{
+    auto i = std::adjacent_find(m_names.begin(), m_names.end(), std::greater_equal<std::string_view>());
+    MYASSERT(i == m_names.end(), "Risk factors not sorted or duplicated: " << *i << ", " << *(i + 1));
+}
+
+size_t SymbolTable::find(std::string_view name) const
+{
+    auto i = std::lower_bound(m_names.begin(), m_names.end(), name);
+    return (i != m_names.end() && *i == name) ? size_t(i - m_names.begin()) : npos;
+}
+
+std::pair<size_t, size_t> SymbolTable::prefix_range(std::string_view prefix) const
+{
+    auto b = std::lower_bound(m_names.begin(), m_names.end(), prefix);
+    auto e = std::partition_point(b, m_names.end(), [&prefix](std::string_view n) {
+        return n.starts_with(prefix);
+    });
+    return std::make_pair(size_t(b - m_names.begin()), size_t(e - m_names.begin()));
+}
+
+} // namespace minirisk
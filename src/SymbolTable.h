@@ -0,0 +1,49 @@
+#pragma once
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "Global.h"
+
+namespace minirisk {
+
+// Immutable set of risk factor names, each mapped to a dense id.
+// Ids follow the lexicographic order of the names, so iterating over ids
+// visits the names sorted, and all the names sharing a prefix have
+// consecutive ids.
+struct SymbolTable
+{
+    static const size_t npos = size_t(-1);
+
+    // names must be unique, they do not need to be sorted
+    SymbolTable(std::vector<string> names);
+
+    // names referring to memory kept alive by owner (e.g. a mapped file), which are
+    // used in place. They must be sorted and unique: as ids are positions, sorting
+    // them would detach them from any data stored in the same order.
+    SymbolTable(std::vector<std::string_view> names, std::shared_ptr<const void> owner);
+
+    // m_names may point into m_storage
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+
+    size_t size() const { return m_names.size(); }
+
+    // id of a name, npos if not present
+    size_t find(std::string_view name) const;
+
+    std::string_view name(size_t id) const { return m_names[id]; }
+
+    // ids [first,second) of the names starting with prefix
+    std::pair<size_t, size_t> prefix_range(std::string_view prefix) const;
+
+private:
+    std::vector<std::string_view> m_names; // sorted
+    std::vector<string> m_storage;         // storage of m_names, if owned
+    std::shared_ptr<const void> m_owner;   // storage of m_names, if not owned
+};
+
+typedef std::shared_ptr<const SymbolTable> psymbols_t;
+
+} // namespace minirisk
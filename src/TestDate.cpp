@@ -1,20 +1,168 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "Date.h"
+#include "Streamer.h"
+
+using namespace minirisk;
+
+// Reference implementation: the original Date, storing year, month and day and
+// computing the serial number on demand. The tests check that Date behaves the same.
+struct RefDate
+{
+    static const std::array<unsigned, 12> days_in_month;
+    static const std::array<unsigned, 12> days_ytd;
+
+    static bool is_leap_year(unsigned year)
+    {
+        return ((year % 4 != 0) ? false : (year % 100 != 0) ? true : (year % 400 != 0) ? false : true);
+    }
+
+    static bool is_valid(unsigned y, unsigned m, unsigned d)
+    {
+        if (y < 1900 || y >= 2200 || m < 1 || m > 12)
+            return false;
+        unsigned dmax = days_in_month[m - 1] + ((m == 2 && is_leap_year(y)) ? 1 : 0);
+        return d >= 1 && d <= dmax;
+    }
+
+    RefDate(unsigned y, unsigned m, unsigned d) : m_y(y), m_m(m), m_d(d) {}
+
+    unsigned serial() const
+    {
+        unsigned s = 0;
+        for (unsigned y = 1900; y < m_y; ++y)
+            s += 365 + (is_leap_year(y) ? 1 : 0);
+        return s + days_ytd[m_m - 1] + ((m_m > 2 && is_leap_year(m_y)) ? 1 : 0) + (m_d - 1);
+    }
+
+    std::string to_string(bool pretty) const
+    {
+        char buf[16];
+        if (pretty)
+            std::snprintf(buf, sizeof(buf), "%u-%u-%u", m_d, m_m, m_y);
+        else
+            std::snprintf(buf, sizeof(buf), "%04u%02u%02u", m_y, m_m, m_d);
+        return buf;
+    }
+
+    unsigned m_y, m_m, m_d;
+};
+
+const std::array<unsigned, 12> RefDate::days_in_month = { {31,28,31,30,31,30,31,31,30,31,30,31} };
+const std::array<unsigned, 12> RefDate::days_ytd{ {0,31,59,90,120,151,181,212,243,273,304,334} };
+
+// all valid dates in the supported range, in chronological order
+std::vector<RefDate> all_dates()
+{
+    std::vector<RefDate> res;
+    for (unsigned y = Date::first_year; y < Date::last_year; ++y)
+        for (unsigned m = 1; m <= 12; ++m)
+            for (unsigned d = 1; RefDate::is_valid(y, m, d); ++d)
+                res.emplace_back(y, m, d);
+    return res;
+}
+
+// deterministic pseudo random numbers
+uint64_t next_random(uint64_t& state)
+{
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return state >> 33;
+}
+
+// construction from year, month and day accepts exactly the valid dates
 void test1()
 {
+    for (unsigned y = Date::first_year - 1; y <= Date::last_year; ++y)
+        for (unsigned m = 0; m <= 13; ++m)
+            for (unsigned d = 0; d <= 32; ++d) {
+                bool ok = true;
+                try {
+                    Date(y, m, d);
+                }
+                catch (const std::exception&) {
+                    ok = false;
+                }
+                MYASSERT(ok == RefDate::is_valid(y, m, d), "Validity mismatch for " << y << "-" << m << "-" << d);
+            }
+
+    MYASSERT(RefDate::is_leap_year(2000) == Date::is_leap_year(2000), "Leap year mismatch");
+    for (unsigned y = Date::first_year; y < Date::last_year; ++y)
+        MYASSERT(RefDate::is_leap_year(y) == Date::is_leap_year(y), "Leap year mismatch for " << y);
+
+    // default date
+    MYASSERT(Date() == Date(1970, 1, 1), "Unexpected default date " << Date().to_string());
 }
 
+// serial numbers and conversions back to year, month and day
 void test2()
 {
+    std::vector<RefDate> dates = all_dates();
+    unsigned expected = 0;
+    for (const RefDate& r : dates) {
+        Date d(r.m_y, r.m_m, r.m_d);
+        MYASSERT(d.serial() == r.serial() && d.serial() == expected, "Serial mismatch for " << r.to_string(true));
+        Date s(expected);
+        MYASSERT(s == d, "Serial round trip failed for " << r.to_string(true));
+        MYASSERT(s.year() == r.m_y && s.month() == r.m_m && s.day() == r.m_d, "Decomposition mismatch for " << r.to_string(true));
+        MYASSERT(s.to_string(true) == r.to_string(true) && s.to_string(false) == r.to_string(false),
+            "Formatting mismatch for " << r.to_string(true) << ", got " << s.to_string(true));
+        ++expected;
+    }
+
+    bool ok = true;
+    try {
+        Date tmp(expected);
+    }
+    catch (const std::exception&) {
+        ok = false;
+    }
+    MYASSERT(!ok, "Serial " << expected << " beyond the last supported year was accepted");
 }
 
+// differences, comparisons and year fractions
 void test3()
 {
+    std::vector<RefDate> dates = all_dates();
+    uint64_t state = 42;
+    const size_t n = 100000;
+    std::vector<Date> d2(n);
+    std::vector<double> expected(n);
+    const RefDate& r1 = dates[next_random(state) % dates.size()];
+    const Date d1(r1.m_y, r1.m_m, r1.m_d);
+    for (size_t i = 0; i < n; ++i) {
+        const RefDate& ra = dates[next_random(state) % dates.size()];
+        const RefDate& rb = dates[next_random(state) % dates.size()];
+        Date a(ra.m_y, ra.m_m, ra.m_d), b(rb.m_y, rb.m_m, rb.m_d);
+        long diff = long(ra.serial()) - long(rb.serial());
+        MYASSERT(a - b == diff, "Difference mismatch between " << a << " and " << b);
+        MYASSERT((a < b) == (diff < 0) && (a > b) == (diff > 0) && (a == b) == (diff == 0),
+            "Comparison mismatch between " << a << " and " << b);
+        MYASSERT(time_frac(b, a) == static_cast<double>(diff) / 365.0, "Year fraction mismatch between " << b << " and " << a);
+        d2[i] = a;
+        expected[i] = static_cast<double>(long(ra.serial()) - long(r1.serial())) / 365.0;
+    }
+
+    // bulk year fractions are identical to the scalar ones
+    std::vector<double> out(n);
+    time_frac(d1, d2, out);
+    for (size_t i = 0; i < n; ++i)
+        MYASSERT(out[i] == expected[i] && out[i] == time_frac(d1, d2[i]), "Bulk year fraction mismatch for " << d2[i]);
 }
 
 int main()
 {
-    test1();
-    test2();
-    test3();
+    try {
+        test1();
+        test2();
+        test3();
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return -1;
+    }
     return 0;
 }
-
@@ -0,0 +1,82 @@
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "Streamer.h"
+
+using namespace minirisk;
+
+// name of the scratch file written by the tests, in the working directory
+const char* const tmp_file = "TestStreamer.tmp";
+
+// lines longer than the read buffer are returned whole, and the lines around them intact
+void test1()
+{
+    const size_t n = 3 << 20; // several times the size of the read buffer
+    std::string big(n, 'x');
+    for (size_t i = 0; i < n; i += 997)
+        big[i] = char('a' + i % 26);
+    {
+        std::ofstream of(tmp_file, std::ios::binary);
+        of << "first;1;\n" << big << ";2;\n" << "last;" << big.substr(0, n / 2) << ";\n";
+    }
+
+    my_ifstream is(tmp_file);
+    string s;
+    int k = 0;
+    MYASSERT(is.read_line(), "Missing first line");
+    is >> s >> k;
+    MYASSERT(s == "first" && k == 1, "First line corrupted");
+    MYASSERT(is.read_line(), "Missing long line");
+    is >> s >> k;
+    MYASSERT(s == big && k == 2, "Long line corrupted");
+    MYASSERT(is.read_line(), "Missing last line");
+    is >> s;
+    MYASSERT(s == "last", "Last line corrupted");
+    is >> s;
+    MYASSERT(s == big.substr(0, n / 2), "Last line corrupted");
+    MYASSERT(!is.read_line() && is.eof(), "Unexpected data after the last line");
+    std::remove(tmp_file);
+}
+
+// doubles in decimal notation and as the hexadecimal digits of their bits
+void test2()
+{
+    const std::string text = "4034000000000000;0x4024000000000000;-0.15625;1.0000000000000000e+15; +2.5;bfc4000000000000;\n";
+    my_ifstream is(text.data(), text.data() + text.size());
+    MYASSERT(is.read_line(), "Missing line");
+    const double expected[] = { 20.0, 10.0, -0.15625, 1e15, 2.5, -0.15625 };
+    for (double x : expected) {
+        double v = 0;
+        is >> v;
+        MYASSERT(v == x, "Expected " << x << ", read " << v);
+    }
+
+    for (const std::string bad : { "0x403400000000000", "1e15x", "+-1", "0x40340000000000g0", "" }) {
+        my_ifstream bs(bad.data(), bad.data() + bad.size());
+        bs.read_line();
+        bool ok = true;
+        try {
+            double v;
+            bs >> v;
+        }
+        catch (const std::exception&) {
+            ok = false;
+        }
+        MYASSERT(!ok, "Invalid double accepted: " << bad);
+    }
+}
+
+int main()
+{
+    try {
+        test1();
+        test2();
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        std::remove(tmp_file);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,174 @@
+#include "ThreadPool.h"
+#include "Macros.h"
+
+#include <algorithm>
+
+namespace minirisk {
+
+namespace {
+
+// identifies the queue owned by the current thread. Threads which are not
+// workers of a pool (e.g. the main thread) use queue 0 of that pool.
+thread_local const void* t_pool = nullptr;
+thread_local size_t t_qid = 0;
+
+} // anonymous namespace
+
+// a set of tasks submitted by one call to parallel_for
+struct ThreadPool::batch_t
+{
+    std::atomic<size_t> remaining;
+    std::mutex mutex;
+    std::condition_variable done;
+    std::exception_ptr error;
+    size_t error_begin = size_t(-1); // first element of the chunk which threw error
+};
+
+ThreadPool::ThreadPool(size_t n_threads)
+    : m_pending(0)
+    , m_stop(false)
+{
+    if (n_threads == 0)
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t i = 0; i < n_threads; ++i)
+        m_queues.emplace_back(new queue_t);
+    // queue 0 is served by the threads calling parallel_for
+    for (size_t i = 1; i < n_threads; ++i)
+        m_threads.emplace_back(&ThreadPool::worker_loop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wakeup.notify_all();
+    for (auto& t : m_threads)
+        t.join();
+}
+
+size_t ThreadPool::default_chunk(size_t n) const
+{
+    return std::max<size_t>(1, n / (4 * size()));
+}
+
+bool ThreadPool::pop(size_t qid, task_t& t)
+{
+    queue_t& q = *m_queues[qid];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.tasks.empty())
+        return false;
+    t = q.tasks.back();
+    q.tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::steal(size_t qid, task_t& t)
+{
+    for (size_t i = 1, n = m_queues.size(); i < n; ++i) {
+        queue_t& q = *m_queues[(qid + i) % n];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (!q.tasks.empty()) {
+            t = q.tasks.front();
+            q.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::acquire(size_t qid, task_t& t)
+{
+    if (m_pending.load() == 0)
+        return false;
+    if (pop(qid, t) || steal(qid, t)) {
+        --m_pending;
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::execute(const task_t& t)
+{
+    batch_t& b = *t.batch;
+    try {
+        (*t.f)(t.begin, t.end);
+    }
+    catch (...) {
+        std::lock_guard<std::mutex> lock(b.mutex);
+        if (t.begin < b.error_begin) {
+            b.error = std::current_exception();
+            b.error_begin = t.begin;
+        }
+    }
+    if (--b.remaining == 0) {
+        // lock to make sure the owner is either before its check or already waiting
+        std::lock_guard<std::mutex> lock(b.mutex);
+        b.done.notify_all();
+    }
+}
+
+void ThreadPool::worker_loop(size_t qid)
+{
+    t_pool = this;
+    t_qid = qid;
+    task_t t;
+    for (;;) {
+        if (acquire(qid, t)) {
+            execute(t);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_wakeup.wait(lock, [this] { return m_stop || m_pending.load() > 0; });
+        if (m_stop)
+            return;
+    }
+}
+
+void ThreadPool::parallel_for(size_t n, size_t chunk_size, const range_fn_t& f)
+{
+    if (n == 0)
+        return;
+    MYASSERT(chunk_size > 0, "Chunk size must be positive");
+
+    const size_t qid = (t_pool == this) ? t_qid : 0;
+
+    // no worker threads: avoid queueing altogether
+    if (m_threads.empty()) {
+        for (size_t b = 0; b < n; b += chunk_size)
+            f(b, std::min(n, b + chunk_size));
+        return;
+    }
+
+    batch_t batch;
+    const size_t n_chunks = (n + chunk_size - 1) / chunk_size;
+    batch.remaining = n_chunks;
+
+    // deal chunks round robin, starting from the queue of the calling thread
+    for (size_t c = 0; c < n_chunks; ++c) {
+        size_t begin = c * chunk_size;
+        queue_t& q = *m_queues[(qid + c) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        q.tasks.push_back(task_t{ &f, begin, std::min(n, begin + chunk_size), &batch });
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending += n_chunks;
+    }
+    m_wakeup.notify_all();
+
+    // help until there is nothing left to take, then wait for the chunks in flight
+    task_t t;
+    while (batch.remaining.load() > 0 && acquire(qid, t))
+        execute(t);
+    {
+        std::unique_lock<std::mutex> lock(batch.mutex);
+        batch.done.wait(lock, [&batch] { return batch.remaining.load() == 0; });
+    }
+
+    if (batch.error)
+        std::rethrow_exception(batch.error);
+}
+
+} // namespace minirisk
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Global.h"
+
+namespace minirisk {
+
+// Fixed size pool of worker threads with one task queue per thread.
+// A thread takes work from the back of its own queue and, when that is empty,
+// steals from the front of the queues of the other threads.
+// The thread calling parallel_for takes part in the computation, hence a pool
+// of size 1 has no worker threads and runs everything on the calling thread.
+struct ThreadPool
+{
+    typedef std::function<void(size_t, size_t)> range_fn_t;
+
+    // n_threads = 0 means one thread per hardware core
+    explicit ThreadPool(size_t n_threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // number of threads taking part in a parallel_for, including the caller
+    size_t size() const { return m_queues.size(); }
+
+    // split [0,n) in chunks of at most chunk_size elements and call f(begin,end)
+    // on each chunk. Blocks until all chunks are processed. If any call throws,
+    // the exception of the lowest chunk is rethrown to the caller, i.e. the one a
+    // serial loop over [0,n) would have thrown, whatever the timing of the threads.
+    void parallel_for(size_t n, size_t chunk_size, const range_fn_t& f);
+
+    // chunk size giving a few chunks per thread, so that stealing can balance the load
+    size_t default_chunk(size_t n) const;
+
+private:
+    struct batch_t;
+
+    struct task_t
+    {
+        const range_fn_t* f;
+        size_t begin;
+        size_t end;
+        batch_t* batch;
+    };
+
+    struct queue_t
+    {
+        std::mutex mutex;
+        std::deque<task_t> tasks;
+    };
+
+    bool pop(size_t qid, task_t& t);
+    bool steal(size_t qid, task_t& t);
+    bool acquire(size_t qid, task_t& t);
+    void execute(const task_t& t);
+    void worker_loop(size_t qid);
+
+private:
+    std::vector<std::unique_ptr<queue_t>> m_queues;
+    std::vector<std::thread> m_threads;
+
+    // idle workers sleep on m_wakeup until a task is queued or the pool stops
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    std::atomic<size_t> m_pending;
+    bool m_stop;
+};
+
+// size of the pool to use for an optional pool pointer
+inline size_t pool_size(const ThreadPool* pool)
+{
+    return pool ? pool->size() : 1;
+}
+
+} // namespace minirisk
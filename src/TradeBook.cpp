@@ -0,0 +1,167 @@
+#include "TradeBook.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+#include <type_traits>
+
+namespace minirisk {
+
+namespace {
+
+// size of the first block requested by the arenas, which then grow geometrically
+const size_t initial_arena_bytes = size_t(1) << 16;
+
+// parse into a temporary, so that nothing is added to the book if the line is invalid
+template <typename T>
+struct book_loader
+{
+    static book_handle_t call(TradeBook& book, my_ifstream& is)
+    {
+        T t;
+        static_cast<ITrade&>(t).load(is);
+        return book.add(t);
+    }
+};
+
+typedef book_handle_t (*book_loader_t)(TradeBook&, my_ifstream&);
+
+constexpr auto book_loaders = make_dispatch_table<book_loader_t, book_loader>(trade_types_t());
+
+} // anonymous namespace
+
+TradeBook::TradeBook()
+    : m_arena(initial_arena_bytes)
+    , m_trades(&m_arena)
+{
+}
+
+book_handle_t TradeBook::add(const ITrade& trade)
+{
+    book_handle_t h;
+    bool found = visit_type(trade_types_t(), trade.id(), [&](auto* tag) {
+        typedef std::remove_pointer_t<decltype(tag)> T;
+        h = add(static_cast<const T&>(trade));
+    });
+    MYASSERT(found, "Unknown trade type:" << trade.id());
+    return h;
+}
+
+book_handle_t TradeBook::load_trade(my_ifstream& is)
+{
+    // read trade identifier
+    guid_t id;
+    is >> id;
+
+    MYASSERT(id < book_loaders.size() && book_loaders[id], "Unknown trade type:" << id);
+    return book_loaders[id](*this, is);
+}
+
+const ITrade& TradeBook::trade(book_handle_t h) const
+{
+    const ITrade* t = nullptr;
+    visit_type(trade_types_t(), h.type, [&](auto* tag) {
+        t = &m_trades.template get<std::remove_pointer_t<decltype(tag)>>()[h.index];
+    });
+    MYASSERT(t, "Unknown trade type:" << h.type);
+    return *t;
+}
+
+portfolio_t TradeBook::portfolio()
+{
+    std::shared_ptr<TradeBook> self(shared_from_this());
+    portfolio_t res;
+    res.reserve(m_handles.size());
+    for (const auto& h : m_handles)
+        res.emplace_back(self, const_cast<ITrade*>(&trade(h)));
+    return res;
+}
+
+size_t TradeBook::memory() const
+{
+    size_t n = 0;
+    for_each_type(trade_types_t(), [&](auto* tag) {
+        n += m_trades.template get<std::remove_pointer_t<decltype(tag)>>().capacity_bytes();
+    });
+    return n;
+}
+
+PricerBook::PricerBook()
+    : m_arena(initial_arena_bytes)
+    , m_pricers(&m_arena)
+{
+}
+
+std::shared_ptr<PricerBook> PricerBook::create(const portfolio_t& portfolio)
+{
+    PROFILE_SCOPE("pricers.create");
+    auto book = std::make_shared<PricerBook>();
+    for (const auto& pt : portfolio)
+        book->add(*pt);
+    return book;
+}
+
+book_handle_t PricerBook::add(const ITrade& trade)
+{
+    bool found = visit_type(trade_types_t(), trade.id(), [&](auto* tag) {
+        typedef std::remove_pointer_t<decltype(tag)> T;
+        size_t i = m_pricers.template get<typename T::pricer_t>().emplace_back(static_cast<const T&>(trade));
+        m_positions[T::m_id].push_back(uint32_t(m_handles.size()));
+        m_handles.push_back(book_handle_t{ T::m_id, uint32_t(i) });
+    });
+    MYASSERT(found, "Unknown trade type:" << trade.id());
+    return m_handles.back();
+}
+
+const IPricer& PricerBook::pricer(book_handle_t h) const
+{
+    const IPricer* p = nullptr;
+    visit_type(trade_types_t(), h.type, [&](auto* tag) {
+        p = &m_pricers.template get<typename std::remove_pointer_t<decltype(tag)>::pricer_t>()[h.index];
+    });
+    MYASSERT(p, "Unknown trade type:" << h.type);
+    return *p;
+}
+
+std::vector<ppricer_t> PricerBook::pricers()
+{
+    std::shared_ptr<const PricerBook> self(shared_from_this());
+    std::vector<ppricer_t> res;
+    res.reserve(m_handles.size());
+    for (const auto& h : m_handles)
+        res.emplace_back(self, &pricer(h));
+    return res;
+}
+
+portfolio_values_t PricerBook::price(Market& mkt, ThreadPool* pool, portfolio_dependencies_t* deps) const
+{
+    portfolio_values_t prices(m_handles.size());
+    if (deps)
+        deps->assign(m_handles.size(), Market::risk_factor_names_t());
+
+    for_each_type(trade_types_t(), [&](auto* tag) {
+        typedef std::remove_pointer_t<decltype(tag)> T;
+        const ArenaVector<typename T::pricer_t>& store = m_pricers.template get<typename T::pricer_t>();
+        const std::vector<uint32_t>& pos = m_positions[T::m_id];
+
+        // the pricer types are final, hence these are direct calls
+        auto price_range = [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i) {
+                if (deps) {
+                    Market::dependency_recorder rec((*deps)[pos[i]]);
+                    prices[pos[i]] = store[i].price(mkt);
+                }
+                else
+                    prices[pos[i]] = store[i].price(mkt);
+            }
+        };
+
+        if (pool_size(pool) == 1)
+            price_range(0, store.size());
+        else if (store.size() > 0)
+            pool->parallel_for(store.size(), pool->default_chunk(store.size()), price_range);
+    });
+    return prices;
+}
+
+} // namespace minirisk
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+#include "PortfolioUtils.h"
+#include "TradeTypes.h"
+
+namespace minirisk {
+
+// Lightweight reference to an object of a book: its trade type and its index among
+// the objects of that type
+struct book_handle_t
+{
+    guid_t type;
+    uint32_t index;
+};
+
+// Portfolio storage. Trades are placed contiguously by type in a monotonic arena and
+// referred to by handles; everything is freed in one shot when the book is destroyed.
+// There is one container per type of trade_types_t.
+// The book must be owned by a shared pointer: the shared pointer API (portfolio_t)
+// is provided on top, with pointers sharing the ownership of the book rather than
+// one heap object and reference count per trade.
+// A book is not thread safe: concurrent loaders must use one book each.
+struct TradeBook : std::enable_shared_from_this<TradeBook>
+{
+    TradeBook();
+
+    // add a copy of a trade of a registered type
+    template <typename T>
+    book_handle_t add(const T& trade)
+    {
+        m_handles.push_back(book_handle_t{ T::m_id, uint32_t(m_trades.template get<T>().emplace_back(trade)) });
+        return m_handles.back();
+    }
+
+    // add a copy of a trade, dispatching on its type
+    book_handle_t add(const ITrade& trade);
+
+    // read one trade from the current line of a text portfolio
+    book_handle_t load_trade(my_ifstream& is);
+
+    // number of trades, and handle of the i-th trade in insertion order
+    size_t size() const { return m_handles.size(); }
+    book_handle_t handle(size_t i) const { return m_handles[i]; }
+
+    const ITrade& trade(book_handle_t h) const;
+
+    // all the trades in insertion order
+    portfolio_t portfolio();
+
+    // bytes reserved by the arena
+    size_t memory() const;
+
+private:
+    std::pmr::monotonic_buffer_resource m_arena;
+    arena_stores<trade_types_t> m_trades;
+    std::vector<book_handle_t> m_handles;
+};
+
+// Pricers stored contiguously by type in a monotonic arena, see TradeBook.
+struct PricerBook : std::enable_shared_from_this<PricerBook>
+{
+    PricerBook();
+
+    // book with the pricers of all the trades of a portfolio
+    static std::shared_ptr<PricerBook> create(const portfolio_t& portfolio);
+
+    // add the pricer of a trade of a registered type
+    book_handle_t add(const ITrade& trade);
+
+    size_t size() const { return m_handles.size(); }
+    book_handle_t handle(size_t i) const { return m_handles[i]; }
+
+    const IPricer& pricer(book_handle_t h) const;
+
+    // all the pricers in insertion order
+    std::vector<ppricer_t> pricers();
+
+    // Same as compute_prices(pricers(), mkt, pool, deps), but each pricer type is priced
+    // by its own loop over its contiguous storage, where the pricing calls are resolved
+    // at compile time rather than through the IPricer interface.
+    portfolio_values_t price(Market& mkt, ThreadPool* pool = nullptr, portfolio_dependencies_t* deps = nullptr) const;
+
+private:
+    typedef pricer_types<trade_types_t>::type pricer_list_t;
+
+    std::pmr::monotonic_buffer_resource m_arena;
+    arena_stores<pricer_list_t> m_pricers;
+    std::vector<book_handle_t> m_handles;
+    std::array<std::vector<uint32_t>, max_guid(trade_types_t()) + 1> m_positions; // by type, insertion index of each pricer
+};
+
+} // namespace minirisk
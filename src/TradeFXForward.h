@@ -0,0 +1,99 @@
+#pragma once
+
+#include "Trade.h"
+
+namespace minirisk {
+
+struct PricerFXForward;
+
+// Forward purchase of quantity units of ccy1 against ccy2, at strike units of ccy2
+// per unit of ccy1. The exchange rate is fixed on the fixing date and the
+// difference is settled in ccy2 on the settlement date.
+struct TradeFXForward : Trade<TradeFXForward>
+{
+    friend struct Trade<TradeFXForward>;
+
+    static constexpr guid_t m_id = 3;
+    static const std::string m_name;
+
+    typedef PricerFXForward pricer_t;
+
+    TradeFXForward() {}
+
+    void init(const std::string& ccy1, const std::string& ccy2, double quantity, double strike, const Date& fixing_date, const Date& settlement_date)
+    {
+        Trade::init(quantity);
+        m_ccy1 = ccy1;
+        m_ccy2 = ccy2;
+        m_strike = strike;
+        m_fixing_date = fixing_date;
+        m_settlement_date = settlement_date;
+    }
+
+    virtual ppricer_t pricer() const;
+
+    const string& ccy1() const
+    {
+        return m_ccy1;
+    }
+
+    const string& ccy2() const
+    {
+        return m_ccy2;
+    }
+
+    double strike() const
+    {
+        return m_strike;
+    }
+
+    const Date& fixing_date() const
+    {
+        return m_fixing_date;
+    }
+
+    const Date& settlement_date() const
+    {
+        return m_settlement_date;
+    }
+
+    // call v(column name, field) for each field of t, for the columnar format (see PortfolioColumns)
+    template <typename Self, typename V>
+    static void visit_columns(Self& t, V&& v)
+    {
+        v("ccy1", t.m_ccy1);
+        v("ccy2", t.m_ccy2);
+        v("strike", t.m_strike);
+        v("fixing", t.m_fixing_date);
+        v("settlement", t.m_settlement_date);
+    }
+
+private:
+    void save_details(my_ofstream& os) const
+    {
+        os << m_ccy1 << m_ccy2 << m_strike << m_fixing_date << m_settlement_date;
+    }
+
+    void load_details(my_ifstream& is)
+    {
+        is >> m_ccy1 >> m_ccy2 >> m_strike >> m_fixing_date >> m_settlement_date;
+    }
+
+    void print_details(std::ostream& os) const
+    {
+        os << format_label("Strike level") << m_strike << std::endl;
+        os << format_label("Base Currency") << m_ccy1 << std::endl;
+        os << format_label("Quote Currency") << m_ccy2 << std::endl;
+        os << format_label("Fixing Date") << m_fixing_date << std::endl;
+        os << format_label("Settlement Date") << m_settlement_date << std::endl;
+    }
+
+private:
+    string m_ccy1;
+    string m_ccy2;
+    double m_strike;
+    Date m_fixing_date;
+    Date m_settlement_date;
+};
+
+} // namespace minirisk
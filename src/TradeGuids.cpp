@@ -1,9 +1,10 @@
 #include "TradePayment.h"
+#include "TradeFXForward.h"
 
 namespace minirisk {
 
-const guid_t TradePayment::m_id = 0;
 const std::string TradePayment::m_name = "Payment";
+const std::string TradeFXForward::m_name = "FX.Forward";
 
 } // namespace minirisk
 
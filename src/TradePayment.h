@@ -4,13 +4,17 @@
 
 namespace minirisk {
 
+struct PricerPayment;
+
 struct TradePayment : Trade<TradePayment>
 {
     friend struct Trade<TradePayment>;
 
-    static const guid_t m_id;
+    static constexpr guid_t m_id = 0;
     static const std::string m_name;
 
+    typedef PricerPayment pricer_t;
+
     TradePayment() {}
 
     void init(const std::string& ccy, double quantity, const Date& delivery_date)
@@ -32,6 +36,14 @@ struct TradePayment : Trade<TradePayment>
         return m_delivery_date;
     }
 
+    // call v(column name, field) for each field of t, for the columnar format (see PortfolioColumns)
+    template <typename Self, typename V>
+    static void visit_columns(Self& t, V&& v)
+    {
+        v("ccy", t.m_ccy);
+        v("delivery", t.m_delivery_date);
+    }
+
 private:
     void save_details(my_ofstream& os) const
     {
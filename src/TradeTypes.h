@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <tuple>
+
+#include "Arena.h"
+#include "TradePayment.h"
+#include "PricerPayment.h"
+#include "TradeFXForward.h"
+#include "PricerFXForward.h"
+
+namespace minirisk {
+
+template <typename... T>
+struct type_list
+{
+    static const size_t size = sizeof...(T);
+};
+
+// Registry of all the trade types.
+// Each type T defines its guid T::m_id, its name T::m_name, its pricer type T::pricer_t
+// and its fields T::visit_columns.
+// Loaders, the columnar format, the storage of trade and pricer books and the pricing
+// loops are generated from this list: adding a trade type only requires adding it here.
+typedef type_list<TradePayment, TradeFXForward> trade_types_t;
+
+// call f(static_cast<T*>(nullptr)) for each type T of the list, in order
+template <typename... T, typename F>
+void for_each_type(type_list<T...>, F&& f)
+{
+    (f(static_cast<T*>(nullptr)), ...);
+}
+
+// call f(static_cast<T*>(nullptr)) for the type T of the list with guid id.
+// Returns false if there is no such type.
+template <typename... T, typename F>
+bool visit_type(type_list<T...>, guid_t id, F&& f)
+{
+    return ((T::m_id == id && (f(static_cast<T*>(nullptr)), true)) || ...);
+}
+
+// largest guid of the types in the list
+template <typename... T>
+constexpr guid_t max_guid(type_list<T...>)
+{
+    guid_t res = 0;
+    ((res = T::m_id > res ? T::m_id : res), ...);
+    return res;
+}
+
+// Table indexed by guid, with entry f<T> for each type T of the list and null
+// entries for the guids which are not used: runtime dispatch on a guid is a single
+// indexed load rather than a chain of comparisons.
+template <typename Fn, template <typename> class Entry, typename... T>
+constexpr std::array<Fn, max_guid(type_list<T...>()) + 1> make_dispatch_table(type_list<T...>)
+{
+    std::array<Fn, max_guid(type_list<T...>()) + 1> table{};
+    ((table[T::m_id] = &Entry<T>::call), ...);
+    return table;
+}
+
+// one ArenaVector per type of the list, all allocating from the same arena
+template <typename L>
+struct arena_stores;
+
+template <typename... T>
+struct arena_stores<type_list<T...>>
+{
+    explicit arena_stores(std::pmr::memory_resource* mem)
+        : m_stores(((void)sizeof(T), mem)...)
+    {
+    }
+
+    template <typename U>
+    ArenaVector<U>& get() { return std::get<ArenaVector<U>>(m_stores); }
+
+    template <typename U>
+    const ArenaVector<U>& get() const { return std::get<ArenaVector<U>>(m_stores); }
+
+private:
+    std::tuple<ArenaVector<T>...> m_stores;
+};
+
+// list of the pricer types of a list of trade types
+template <typename L>
+struct pricer_types;
+
+template <typename... T>
+struct pricer_types<type_list<T...>>
+{
+    typedef type_list<typename T::pricer_t...> type;
+};
+
+} // namespace minirisk
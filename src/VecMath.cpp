@@ -0,0 +1,96 @@
+#include "VecMath.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX512F__) || (defined(__AVX2__) && defined(__FMA__))
+#include <immintrin.h>
+#endif
+
+// gcc 12 reports spurious uninitialized values inside the AVX-512 intrinsics headers
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+// exp(x) = 2^n * exp(r), with n = round(x/ln2) and |r| <= ln2/2.
+// exp(r) is approximated by its Taylor expansion up to degree 13, whose truncation
+// error (|r|^14/14! < 5e-18) is well below the double precision epsilon.
+// ln2 is split in a high part with trailing zero bits, so that n*ln2_hi is exact.
+
+namespace minirisk {
+
+namespace {
+
+const double exp_hi = 709.0;
+const double exp_lo = -708.0;
+const double log2e = 1.4426950408889634;
+const double ln2_hi = 6.93147180369123816490e-01;
+const double ln2_lo = 1.90821492927058770002e-10;
+const double shift = 4503599627370496.0 + 1023.0; // 2^52 + exponent bias
+
+// 1/k! for k = 13..0, in Horner order
+const double coef[] = {
+    1.0 / 6227020800.0, 1.0 / 479001600.0, 1.0 / 39916800.0, 1.0 / 3628800.0,
+    1.0 / 362880.0, 1.0 / 40320.0, 1.0 / 5040.0, 1.0 / 720.0,
+    1.0 / 120.0, 1.0 / 24.0, 1.0 / 6.0, 1.0 / 2.0, 1.0, 1.0 };
+const size_t n_coef = sizeof(coef) / sizeof(coef[0]);
+
+inline double exp_scalar(double x)
+{
+    x = std::fmin(std::fmax(x, exp_lo), exp_hi);
+    double n = std::nearbyint(x * log2e);
+    double r = std::fma(-n, ln2_hi, x);
+    r = std::fma(-n, ln2_lo, r);
+    double p = coef[0];
+    for (size_t k = 1; k < n_coef; ++k)
+        p = std::fma(p, r, coef[k]);
+    // build 2^n from the low bits of n + shift
+    double t = n + shift;
+    uint64_t bits;
+    std::memcpy(&bits, &t, sizeof(bits));
+    bits <<= 52;
+    double scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+    return p * scale;
+}
+
+} // anonymous namespace
+
+void vexp(const double* x, double* y, size_t n)
+{
+    size_t i = 0;
+
+#if defined(__AVX512F__)
+    for (; i + 8 <= n; i += 8) {
+        __m512d v = _mm512_loadu_pd(x + i);
+        v = _mm512_min_pd(_mm512_max_pd(v, _mm512_set1_pd(exp_lo)), _mm512_set1_pd(exp_hi));
+        __m512d k = _mm512_roundscale_pd(_mm512_mul_pd(v, _mm512_set1_pd(log2e)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m512d r = _mm512_fnmadd_pd(k, _mm512_set1_pd(ln2_hi), v);
+        r = _mm512_fnmadd_pd(k, _mm512_set1_pd(ln2_lo), r);
+        __m512d p = _mm512_set1_pd(coef[0]);
+        for (size_t c = 1; c < n_coef; ++c)
+            p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(coef[c]));
+        __m512i e = _mm512_slli_epi64(_mm512_castpd_si512(_mm512_add_pd(k, _mm512_set1_pd(shift))), 52);
+        _mm512_storeu_pd(y + i, _mm512_mul_pd(p, _mm512_castsi512_pd(e)));
+    }
+#elif defined(__AVX2__) && defined(__FMA__)
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = _mm256_loadu_pd(x + i);
+        v = _mm256_min_pd(_mm256_max_pd(v, _mm256_set1_pd(exp_lo)), _mm256_set1_pd(exp_hi));
+        __m256d k = _mm256_round_pd(_mm256_mul_pd(v, _mm256_set1_pd(log2e)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m256d r = _mm256_fnmadd_pd(k, _mm256_set1_pd(ln2_hi), v);
+        r = _mm256_fnmadd_pd(k, _mm256_set1_pd(ln2_lo), r);
+        __m256d p = _mm256_set1_pd(coef[0]);
+        for (size_t c = 1; c < n_coef; ++c)
+            p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(coef[c]));
+        __m256i e = _mm256_slli_epi64(_mm256_castpd_si256(_mm256_add_pd(k, _mm256_set1_pd(shift))), 52);
+        _mm256_storeu_pd(y + i, _mm256_mul_pd(p, _mm256_castsi256_pd(e)));
+    }
+#endif
+
+    for (; i < n; ++i)
+        y[i] = exp_scalar(x[i]);
+}
+
+} // namespace minirisk
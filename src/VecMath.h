@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+
+namespace minirisk {
+
+// y[i] = exp(x[i]) for i in [0,n), x and y may alias.
+// Uses AVX-512 or AVX2+FMA when the compiler targets them (see -march in the Makefile),
+// and the same algorithm in scalar form for the remaining elements, so the result
+// does not depend on the position of an element in the array.
+// Accuracy: relative error below 3e-16 (about 1 ulp) with respect to std::exp.
+// Arguments are clamped to [-708, 709], i.e. results never underflow to
+// denormals or overflow to infinity, which is more than enough for discounting.
+void vexp(const double* x, double* y, size_t n);
+
+} // namespace minirisk